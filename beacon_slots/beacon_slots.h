@@ -0,0 +1,229 @@
+/**
+ * MODULE OF mlst_network.h
+ *
+ * Slotted beacons for dense neighborhoods (`#define MLST_BEACON_SLOTS`). Without it every node sends its beacon after a
+ * random fraction of its period, thus in dense clusters many beacons collide and neighbor entries expire falsely.
+ *
+ * The period of the MLST is a frame of BEACON_SLOTS slots. Every node sends its beacon at the begin of its own slot (plus a
+ * small random offset), thus the beacon rate stays the same. The slot is initially a hash of the id. Two neighbors that
+ * have chosen the same slot are detected directly (the slot is part of the public variable), the one with the higher id
+ * moves. For two-hop conflicts every node announces the slots of its neighbors (used) and the slots that are used by more
+ * than one of its neighbors (conflicts). A node whose slot is a conflict of a neighbor moves with probability 1/2, so
+ * one of the two hidden nodes remains. A moving node chooses a random slot that is neither used by a neighbor nor by a
+ * neighbor of a neighbor (if there is one).
+ *
+ * The frame is defined by the root and passed down the tree: every beacon carries the phase of the frame of its sender
+ * (one byte in the appendix, see mlst_write_appendix) and a node adopts the phase of its parent. Nodes that do not know the
+ * frame (not synchronized for BEACON_SLOTS_MAX_UNSYNCED seconds or not part of the tree) and nodes in the fast phase after
+ * a change (divide_period_time_by > 1) use the random period as before. Expedited beacons (answers to solicitations,
+ * acknowledgements) are not slotted. The slots assume a MAC without long broadcast strobes (e.g. nullrdc).
+ * All nodes have to use the same setting.
+ *
+ * User Functions:
+ * ---------------------------
+ * void beacon_slots_init(uint16_t id); //Chooses the initial slot (the root defines the frame). Called by mlst_init().
+ * void beacon_slots_begin(uint16_t id); //Starts the evaluation of the neighborhood
+ * void beacon_slots_neighbor(uint16_t id, uint8_t slot, uint16_t used, uint16_t conflicts); //Adds the slots of a neighbor
+ * void beacon_slots_end(); //Resolves conflicts of the own slot
+ * uint8_t beacon_slots_own(); //The own slot
+ * uint16_t beacon_slots_used(); //The slots of the neighbors (bitmap)
+ * uint16_t beacon_slots_conflicts(); //The slots that are used by more than one neighbor (bitmap)
+ * uint8_t beacon_slots_phase(); //The current phase of the frame for the beacon (0xff: not synchronized)
+ * void beacon_slots_sync(uint8_t phase); //Adopts the phase of the parent (received in its beacon)
+ * clock_time_t beacon_slots_period(clock_time_t delay, uint8_t divided); //The time until the own slot in the next frame
+ * void beacon_slots_print_state(); //Prints the slot, the bitmaps and the number of moves
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef BEACON_SLOTS_H
+#define BEACON_SLOTS_H
+
+#include "contiki.h"
+#include "../timing/timing.h"
+#include <stdio.h>
+
+#ifdef MLST_BEACON_SLOTS
+
+//Number of slots per frame (at most 16, the size of the bitmaps)
+#ifndef BEACON_SLOTS
+#define BEACON_SLOTS 16
+#endif
+//Length of a frame, one period of the MLST
+#ifndef BEACON_SLOTS_FRAME
+#define BEACON_SLOTS_FRAME MLST_PERIOD_TICKS
+#endif
+//Time in seconds after the last synchronization in which the phase is considered as valid (drift of the clocks)
+#ifndef BEACON_SLOTS_MAX_UNSYNCED
+#define BEACON_SLOTS_MAX_UNSYNCED 120
+#endif
+
+#define BEACON_SLOTS_UNSYNCED 0xff
+
+//**VARIABLES**
+uint8_t beacon_slots_slot = 0; //the own slot
+uint16_t beacon_slots_own_id = 0;
+uint16_t beacon_slots_used_map = 0; //slots of the neighbors
+uint16_t beacon_slots_conflict_map = 0; //slots used by more than one neighbor
+uint16_t beacon_slots_blocked = 0; //slots of the neighbors and of their neighbors (not chosen when moving)
+uint8_t beacon_slots_must_move = 0; //1 iff the own slot is in conflict
+uint16_t beacon_slots_moves = 0; //number of changes of the own slot
+clock_time_t beacon_slots_start = 0; //local time of the begin of a frame
+unsigned long beacon_slots_synced_at = 0; //clock_seconds() of the last synchronization
+uint8_t beacon_slots_synced = 0; //1 iff the phase has been received (always for the root)
+//--VARIABLES--
+
+/**
+ * Chooses the initial slot by a hash of the id. The root defines the frame.
+ */
+void beacon_slots_init(uint16_t id)
+{
+	beacon_slots_own_id = id;
+	beacon_slots_slot = ((uint16_t)(id*40503u) >> 8) % BEACON_SLOTS; //Fibonacci hashing, neighboring ids are spread
+#ifdef ROOT
+	beacon_slots_start = clock_time();
+	beacon_slots_synced = 1;
+#endif
+}
+
+/**
+ * Starts the evaluation of the neighborhood, followed by beacon_slots_neighbor for every neighbor and beacon_slots_end.
+ */
+void beacon_slots_begin(uint16_t id)
+{
+	beacon_slots_own_id = id;
+	beacon_slots_used_map = 0;
+	beacon_slots_conflict_map = 0;
+	beacon_slots_blocked = 0;
+	beacon_slots_must_move = 0;
+}
+
+/**
+ * Adds the slot of a neighbor and the slots it has announced (its neighbors and their conflicts).
+ */
+void beacon_slots_neighbor(uint16_t id, uint8_t slot, uint16_t used, uint16_t conflicts)
+{
+	if(slot >= BEACON_SLOTS) return;
+	uint16_t bit = 1<<slot;
+	if(beacon_slots_used_map & bit) beacon_slots_conflict_map |= bit;
+	beacon_slots_used_map |= bit;
+	beacon_slots_blocked |= bit | used;
+	if(slot == beacon_slots_slot && id < beacon_slots_own_id) beacon_slots_must_move = 1; //the lower id keeps the slot
+	if((conflicts & (1<<beacon_slots_slot)) && (timing_rand() & 1)) beacon_slots_must_move = 1; //hidden node, one of both moves
+}
+
+/**
+ * Moves the own slot if it is in conflict, to a random slot that is not blocked (if there is one).
+ */
+void beacon_slots_end()
+{
+	if(beacon_slots_must_move == 0) return;
+	uint16_t blocked = beacon_slots_blocked | (1<<beacon_slots_slot);
+	uint8_t free = 0, i;
+	for(i=0; i<BEACON_SLOTS; i++) if((blocked & (1<<i)) == 0) free++;
+	if(free == 0) return;
+	uint8_t choice = timing_random(free - 1);
+	for(i=0; i<BEACON_SLOTS; i++) {
+		if((blocked & (1<<i)) == 0 && choice-- == 0) {
+			beacon_slots_slot = i;
+			beacon_slots_moves++;
+			return;
+		}
+	}
+}
+
+/**
+ * Returns the own slot.
+ */
+uint8_t beacon_slots_own()
+{
+	return beacon_slots_slot;
+}
+
+/**
+ * Returns the slots of the neighbors as bitmap.
+ */
+uint16_t beacon_slots_used()
+{
+	return beacon_slots_used_map;
+}
+
+/**
+ * Returns the slots that are used by more than one neighbor as bitmap.
+ */
+uint16_t beacon_slots_conflicts()
+{
+	return beacon_slots_conflict_map;
+}
+
+//Returns 1 iff the node knows the current frame
+static uint8_t beacon_slots_is_synced()
+{
+#ifndef ROOT
+	if(beacon_slots_synced != 0 && clock_seconds() - beacon_slots_synced_at > BEACON_SLOTS_MAX_UNSYNCED) {
+		beacon_slots_synced = 0;
+	}
+#endif
+	return beacon_slots_synced;
+}
+
+//Position of the current time in the frame
+static clock_time_t beacon_slots_position()
+{
+	return (clock_time_t)(clock_time() - beacon_slots_start) % BEACON_SLOTS_FRAME;
+}
+
+/**
+ * Returns the current phase of the frame in 1/255 of the frame, BEACON_SLOTS_UNSYNCED if the node does not know it.
+ */
+uint8_t beacon_slots_phase()
+{
+	if(beacon_slots_is_synced() == 0) return BEACON_SLOTS_UNSYNCED;
+	return ((unsigned long) beacon_slots_position())*255/BEACON_SLOTS_FRAME;
+}
+
+/**
+ * Adopts the phase of the parent (received in its beacon just now).
+ */
+void beacon_slots_sync(uint8_t phase)
+{
+#ifndef ROOT
+	if(phase == BEACON_SLOTS_UNSYNCED) return;
+	beacon_slots_start = clock_time() - ((unsigned long) phase)*BEACON_SLOTS_FRAME/255;
+	beacon_slots_synced = 1;
+	beacon_slots_synced_at = clock_seconds();
+#endif
+}
+
+/**
+ * Returns the time until the own slot in the next frame (between a half and one and a half frames). The given (random)
+ * delay is returned if the node does not know the frame or the period is shortened (divided > 1).
+ */
+clock_time_t beacon_slots_period(clock_time_t delay, uint8_t divided)
+{
+	if(divided > 1 || beacon_slots_is_synced() == 0) return delay;
+	clock_time_t slot_length = BEACON_SLOTS_FRAME/BEACON_SLOTS;
+	clock_time_t target = beacon_slots_slot*slot_length + timing_random(slot_length/4);
+	clock_time_t wait = (BEACON_SLOTS_FRAME + target - beacon_slots_position())%BEACON_SLOTS_FRAME;
+	if(wait < BEACON_SLOTS_FRAME/2) wait += BEACON_SLOTS_FRAME;
+	return wait;
+}
+
+/**
+ * Prints the state of the slots, e.g.
+ * BEACON_SLOTS[slot=5, used=0x1a24, conflicts=0x0004, moves=2, phase=17]
+ */
+void beacon_slots_print_state()
+{
+	printf("BEACON_SLOTS[slot=%u, used=0x%04x, conflicts=0x%04x, moves=%u, phase=%u]\n", beacon_slots_slot,
+			beacon_slots_used_map, beacon_slots_conflict_map, beacon_slots_moves, beacon_slots_phase());
+}
+
+#define BEACON_SLOTS_PERIOD(delay, divided) beacon_slots_period(delay, divided)
+#else
+#define BEACON_SLOTS_PERIOD(delay, divided) (delay)
+#endif
+
+#endif
@@ -0,0 +1,166 @@
+/**
+ * MODULE OF mlst_network.h
+ *
+ * Depth-staggered convergecast schedule (`#define MLST_CONVERGECAST`). Without it every hop sends a message after a random
+ * delay, thus the latency grows with the depth and the siblings contend with each other.
+ *
+ * Time is divided into cycles of CONVERGECAST_CYCLE ticks with CONVERGECAST_SLOTS slots. A node with the distance d to the
+ * root sends its messages (first transmissions, the next messages of the queue and the retries) in slot SLOTS-d, the
+ * deeper nodes earlier. Its parent forwards them in the slot right after, thus a reading reaches the root in a single
+ * cycle. Nodes that are deeper than SLOTS-1 share slot 0. Within the slot the start is random (first half of the slot),
+ * the last CONVERGECAST_GUARD ticks of a slot are not used for new transmissions.
+ *
+ * The cycle is defined by the root. Every beacon carries the current phase of the cycle of its sender (one byte, 1/255 of
+ * the cycle, see mlst_write_appendix) and a node adopts the phase of its parent (convergecast_sync). Nodes whose phase
+ * is older than CONVERGECAST_MAX_UNSYNCED seconds (or that are not part of the tree) send as without the schedule.
+ * All nodes have to use the same setting, as the beacons of the two variants are not compatible.
+ *
+ * The backbone keeps listening outside the slots of its children, as its PVN has to receive the beacons of the neighbors.
+ * Leaves only switch on for their own slot.
+ *
+ * User Functions:
+ * ---------------------------
+ * void convergecast_init(); //Starts the schedule (the root defines the cycle). Called by mlst_init().
+ * void convergecast_set_depth(uint8_t depth); //Sets the distance to the root (0xff: undefined). Called by the MLST process.
+ * uint8_t convergecast_phase(); //Returns the current phase of the cycle for the beacon (0xff: not synchronized)
+ * void convergecast_sync(uint8_t phase); //Adopts the phase of the parent (received in its beacon)
+ * uint8_t convergecast_is_synced(); //1 iff the node knows the cycle
+ * clock_time_t convergecast_align(clock_time_t delay); //Returns the delay, deferred to the next own slot
+ * void convergecast_print_state(); //Prints depth, slot, phase and the number of deferred transmissions
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef CONVERGECAST_H
+#define CONVERGECAST_H
+
+#include "contiki.h"
+#include "../timing/timing.h"
+#include <stdio.h>
+
+#ifdef MLST_CONVERGECAST
+
+//Length of a cycle
+#ifndef CONVERGECAST_CYCLE
+#define CONVERGECAST_CYCLE (CLOCK_SECOND*4)
+#endif
+//Number of slots per cycle (the maximal depth that gets its own slot)
+#ifndef CONVERGECAST_SLOTS
+#define CONVERGECAST_SLOTS 8
+#endif
+//End of a slot in which no new transmission is started (timeout of the ACK)
+#ifndef CONVERGECAST_GUARD
+#define CONVERGECAST_GUARD (CLOCK_SECOND/8)
+#endif
+//Time in seconds after the last synchronization in which the phase is considered as valid (drift of the clocks)
+#ifndef CONVERGECAST_MAX_UNSYNCED
+#define CONVERGECAST_MAX_UNSYNCED 120
+#endif
+
+#define CONVERGECAST_SLOT_LENGTH (CONVERGECAST_CYCLE/CONVERGECAST_SLOTS)
+#define CONVERGECAST_UNSYNCED 0xff
+
+//**VARIABLES**
+clock_time_t convergecast_start = 0; //local time of the begin of a cycle
+unsigned long convergecast_synced_at = 0; //clock_seconds() of the last synchronization
+uint8_t convergecast_synced = 0; //1 iff the phase has been received (always for the root)
+uint8_t convergecast_depth = 0xff; //distance to the root
+uint16_t convergecast_deferred = 0; //number of transmissions that have been deferred to the own slot
+//--VARIABLES--
+
+/**
+ * Starts the schedule. The root defines the cycle, the other nodes wait for the beacon of their parent.
+ */
+void convergecast_init()
+{
+#ifdef ROOT
+	convergecast_start = clock_time();
+	convergecast_synced = 1;
+	convergecast_depth = 0;
+#endif
+}
+
+/**
+ * Sets the distance to the root (0xff if the node is not part of the tree).
+ */
+void convergecast_set_depth(uint8_t depth)
+{
+	convergecast_depth = depth;
+}
+
+/**
+ * Returns 1 iff the node knows the current cycle.
+ */
+uint8_t convergecast_is_synced()
+{
+#ifndef ROOT
+	if(convergecast_synced != 0 && clock_seconds() - convergecast_synced_at > CONVERGECAST_MAX_UNSYNCED) {
+		convergecast_synced = 0;
+	}
+#endif
+	return convergecast_synced;
+}
+
+//Position of the given time in the cycle
+static clock_time_t convergecast_position(clock_time_t t)
+{
+	return (clock_time_t)(t - convergecast_start) % CONVERGECAST_CYCLE;
+}
+
+/**
+ * Returns the current phase of the cycle in 1/255 of the cycle, CONVERGECAST_UNSYNCED if the node does not know it.
+ */
+uint8_t convergecast_phase()
+{
+	if(convergecast_is_synced() == 0) return CONVERGECAST_UNSYNCED;
+	return ((unsigned long) convergecast_position(clock_time()))*255/CONVERGECAST_CYCLE;
+}
+
+/**
+ * Adopts the phase of the parent (received in its beacon just now).
+ */
+void convergecast_sync(uint8_t phase)
+{
+#ifndef ROOT
+	if(phase == CONVERGECAST_UNSYNCED) return;
+	convergecast_start = clock_time() - ((unsigned long) phase)*CONVERGECAST_CYCLE/255;
+	convergecast_synced = 1;
+	convergecast_synced_at = clock_seconds();
+#endif
+}
+
+/**
+ * Returns the delay of a transmission that would be started after the given delay: unchanged if it is within the own
+ * slot, otherwise deferred to a random time in the first half of the next own slot. Unchanged if the node is not
+ * synchronized or not part of the tree.
+ */
+clock_time_t convergecast_align(clock_time_t delay)
+{
+	if(convergecast_depth == 0 || convergecast_depth == 0xff || convergecast_is_synced() == 0) return delay;
+	uint8_t slot = convergecast_depth < CONVERGECAST_SLOTS ? CONVERGECAST_SLOTS - convergecast_depth : 0;
+	clock_time_t begin = slot*CONVERGECAST_SLOT_LENGTH;
+	clock_time_t position = convergecast_position(clock_time() + delay);
+	if(position >= begin && position < begin + CONVERGECAST_SLOT_LENGTH - CONVERGECAST_GUARD) return delay;
+	convergecast_deferred++;
+	return delay + (CONVERGECAST_CYCLE + begin - position)%CONVERGECAST_CYCLE + timing_random(CONVERGECAST_SLOT_LENGTH/2 - 1);
+}
+
+/**
+ * Prints the state of the schedule, e.g.
+ * CONVERGECAST[depth=2, slot=6, phase=130, deferred=14]
+ */
+void convergecast_print_state()
+{
+	printf("CONVERGECAST[depth=%u, slot=%u, phase=%u, deferred=%u]\n", convergecast_depth,
+			convergecast_depth < CONVERGECAST_SLOTS ? CONVERGECAST_SLOTS - convergecast_depth : 0, convergecast_phase(),
+			convergecast_deferred);
+}
+
+#define CONVERGECAST_ALIGN(delay) convergecast_align(delay)
+#else
+#define CONVERGECAST_ALIGN(delay) (delay)
+#endif
+
+#endif
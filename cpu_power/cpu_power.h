@@ -0,0 +1,202 @@
+/**
+ * MODULE OF mlst_network.h
+ *
+ * Low power mode of the MCU for idle nodes. Contiki drives all timers (etimer and ctimer) by a single timer, so the MCU
+ * only has to wake up for the next expiration. This module adds two things:
+ *
+ * 1. Wake-up coalescing: The MLST process announces its next wake-up (the end of the current period) as anchor. Timers
+ *    that are not time critical (the first send of an own message of a sleeping leaf, the sampling of the application)
+ *    pass their delay through CPU_POWER_COALESCE(). Forwarded messages and retries are not deferred, they would add the
+ *    delay on every hop. If the timer would expire shortly before the anchor
+ *    (within CPU_POWER_COALESCE_WINDOW), it is deferred to the anchor, so all of them share one wake-up.
+ *    Timers are only deferred, never brought forward.
+ *
+ * 2. Idle path: cpu_power_idle() has to be called by the main loop of the platform if there is nothing to do
+ *    (i.e. process_run() returned 0). It sends the MCU to sleep until the next event. If the radio is switched off by the
+ *    radio power manager (RADIO_POWER_MANAGER, see ../radio_power/radio_power.h), the deepest mode is used
+ *    (CPU_POWER_SLEEP_DEEP, on AVR power-save in which only the asynchronous timer keeps running), otherwise the idle mode
+ *    (CPU_POWER_SLEEP_IDLE), as the RDC needs its timers and interrupts. Without the radio power manager only the idle
+ *    mode is used.
+ *    On INGA the clock has to run on the asynchronous timer (32 kHz crystal), otherwise define CPU_POWER_SLEEP_DEEP as
+ *    CPU_POWER_SLEEP_IDLE.
+ *
+ * The time in the sleep modes is recorded and reported as sleep residency (fraction of the time in deep sleep).
+ * The module is only compiled in if `CPU_POWER_MANAGER` is defined. Otherwise CPU_POWER_COALESCE() returns the delay
+ * unchanged and the other hooks are empty.
+ *
+ * Example of a main loop:
+ *   while(1) {
+ *     watchdog_periodic();
+ *     if(process_run() == 0) cpu_power_idle();
+ *   }
+ *
+ * User Functions:
+ * ---------------------------
+ * void cpu_power_init(); //Starts the accounting. Called by mlst_init().
+ * void cpu_power_idle(); //Sleeps until the next event. Has to be called by the main loop if there is nothing to do.
+ * clock_time_t cpu_power_coalesce(clock_time_t delay); //Returns the delay, deferred to the anchor if it is close to it
+ * void cpu_power_anchor(clock_time_t at); //Sets the next wake-up the other timers are aligned to. Called by the MLST process.
+ * unsigned long cpu_power_deep_ms(); //Time in deep sleep
+ * unsigned long cpu_power_idle_ms(); //Time in idle sleep
+ * uint8_t cpu_power_residency(); //Percentage of the time in deep sleep
+ * void cpu_power_print_state(); //Prints the time in the sleep modes, the residency and the number of wake-ups
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef CPU_POWER_H
+#define CPU_POWER_H
+
+#include "contiki.h"
+#include <stdio.h>
+#include "../radio_power/radio_power.h"
+
+//Maximal deferral of a timer to the anchor
+#ifndef CPU_POWER_COALESCE_WINDOW
+#define CPU_POWER_COALESCE_WINDOW (CLOCK_SECOND/2)
+#endif
+
+#ifdef CPU_POWER_MANAGER
+
+#include "dev/watchdog.h"
+#ifdef __AVR__
+#include <avr/sleep.h>
+#ifndef CPU_POWER_SLEEP_DEEP
+#define CPU_POWER_SLEEP_DEEP() do { set_sleep_mode(SLEEP_MODE_PWR_SAVE); sleep_mode(); } while(0)
+#endif
+#ifndef CPU_POWER_SLEEP_IDLE
+#define CPU_POWER_SLEEP_IDLE() do { set_sleep_mode(SLEEP_MODE_IDLE); sleep_mode(); } while(0)
+#endif
+#else
+//Other platforms have to define the sleep modes, otherwise the idle path only waits
+#ifndef CPU_POWER_SLEEP_DEEP
+#define CPU_POWER_SLEEP_DEEP()
+#endif
+#ifndef CPU_POWER_SLEEP_IDLE
+#define CPU_POWER_SLEEP_IDLE()
+#endif
+#endif
+
+//**VARIABLES**
+clock_time_t cpu_power_anchor_time = 0; //next wake-up of the MLST process
+clock_time_t cpu_power_since = 0; //begin of the accounting
+unsigned long cpu_power_deep_ticks = 0;
+unsigned long cpu_power_idle_ticks = 0;
+uint16_t cpu_power_wakeups = 0; //number of sleeps that have been ended by an event
+uint16_t cpu_power_coalesced = 0; //number of timers that have been deferred to the anchor
+//--VARIABLES--
+
+/**
+ * Sets the next wake-up of the MLST process. Timers passed through cpu_power_coalesce() are aligned to it.
+ */
+void cpu_power_anchor(clock_time_t at)
+{
+	cpu_power_anchor_time = at;
+}
+
+/**
+ * Returns the delay for a timer that is set now. If it would expire within CPU_POWER_COALESCE_WINDOW before the anchor,
+ * the delay until the anchor is returned.
+ */
+clock_time_t cpu_power_coalesce(clock_time_t delay)
+{
+	clock_time_t now = clock_time();
+	if((long)(cpu_power_anchor_time - now) <= 0) return delay; //no anchor in the future
+	clock_time_t to_anchor = cpu_power_anchor_time - now;
+	if(delay < to_anchor && to_anchor - delay <= CPU_POWER_COALESCE_WINDOW) {
+		cpu_power_coalesced++;
+		return to_anchor;
+	}
+	return delay;
+}
+
+/**
+ * Sleeps until the next event (expired timer, received frame, serial input, ...). The clock interrupt wakes up the MCU
+ * every tick, thus the MCU sleeps again until a process has been polled.
+ */
+void cpu_power_idle()
+{
+	clock_time_t start = clock_time();
+#ifdef RADIO_POWER_MANAGER
+	uint8_t deep = (radio_power_is_on() == 0);
+#else
+	uint8_t deep = 0;
+#endif
+	while(process_nevents() == 0) {
+		if(deep) CPU_POWER_SLEEP_DEEP();
+		else CPU_POWER_SLEEP_IDLE();
+		watchdog_periodic();
+	}
+	if(deep) cpu_power_deep_ticks += clock_time() - start;
+	else cpu_power_idle_ticks += clock_time() - start;
+	cpu_power_wakeups++;
+}
+
+//Converts ticks to ms without overflow
+static unsigned long cpu_power_ticks_to_ms(unsigned long ticks)
+{
+	return (ticks/CLOCK_SECOND)*1000 + ((ticks%CLOCK_SECOND)*1000)/CLOCK_SECOND;
+}
+
+/**
+ * Returns the time in ms in deep sleep (since cpu_power_init).
+ */
+unsigned long cpu_power_deep_ms()
+{
+	return cpu_power_ticks_to_ms(cpu_power_deep_ticks);
+}
+
+/**
+ * Returns the time in ms in idle sleep (since cpu_power_init).
+ */
+unsigned long cpu_power_idle_ms()
+{
+	return cpu_power_ticks_to_ms(cpu_power_idle_ticks);
+}
+
+/**
+ * Returns the percentage of the time (since cpu_power_init) in deep sleep.
+ */
+uint8_t cpu_power_residency()
+{
+	unsigned long total = clock_time() - cpu_power_since;
+	if(total < 100) return 0;
+	unsigned long residency = cpu_power_deep_ticks/(total/100); //no 64 bit arithmetic on the MCU
+	return residency > 100 ? 100 : residency;
+}
+
+/**
+ * Starts the accounting. Called by mlst_init().
+ */
+void cpu_power_init()
+{
+	cpu_power_since = clock_time();
+	cpu_power_deep_ticks = 0;
+	cpu_power_idle_ticks = 0;
+	cpu_power_wakeups = 0;
+	cpu_power_coalesced = 0;
+}
+
+/**
+ * Prints the time in the sleep modes, the residency and the number of wake-ups and coalesced timers, e.g.
+ * CPU_POWER[active=300ms, idle=1200ms, deep=8500ms, residency=85%, wakeups=40, coalesced=12]
+ */
+void cpu_power_print_state()
+{
+	unsigned long total = cpu_power_ticks_to_ms(clock_time() - cpu_power_since);
+	unsigned long sleeping = cpu_power_deep_ms() + cpu_power_idle_ms();
+	printf("CPU_POWER[active=%lums, idle=%lums, deep=%lums, residency=%u%%, wakeups=%u, coalesced=%u]\n",
+			total > sleeping ? total - sleeping : 0, cpu_power_idle_ms(), cpu_power_deep_ms(), cpu_power_residency(),
+			cpu_power_wakeups, cpu_power_coalesced);
+}
+
+#define CPU_POWER_ANCHOR(at) cpu_power_anchor(at)
+#define CPU_POWER_COALESCE(delay) cpu_power_coalesce(delay)
+#else
+#define CPU_POWER_ANCHOR(at)
+#define CPU_POWER_COALESCE(delay) (delay)
+#endif
+
+#endif
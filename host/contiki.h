@@ -0,0 +1,230 @@
+/**
+ * HOST SHIM
+ *
+ * A minimal single-node replacement of the Contiki core for native builds of the MLST headers (see ./mlst_replay.c).
+ * Time is virtual and only advances by host_run_until(), so a run only depends on its input and is fully deterministic.
+ * Only the parts of Contiki that are used by this library are implemented: clock, processes (protothreads with the
+ * same local continuation trick as Contiki), etimer and ctimer (./sys/ctimer.h), Rime broadcast/unicast with packetbuf
+ * (./net/rime/rime.h), random (./lib/random.h) and leds (./leds.h).
+ *
+ * Like the library itself, the shim is header-only, so a harness has to be a single translation unit.
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @licence MIT
+ */
+
+#ifndef CONTIKI_H
+#define CONTIKI_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef CLOCK_SECOND
+#define CLOCK_SECOND 128
+#endif
+typedef unsigned long clock_time_t;
+
+//**CLOCK**
+clock_time_t host_now = 0; //the virtual time in ticks
+
+clock_time_t clock_time() { return host_now; }
+unsigned long clock_seconds() { return host_now/CLOCK_SECOND; }
+//--CLOCK--
+
+
+//**PROCESSES**
+typedef unsigned char process_event_t;
+typedef void* process_data_t;
+#define PROCESS_EVENT_INIT 0x81
+#define PROCESS_EVENT_POLL 0x82
+#define PROCESS_EVENT_TIMER 0x88
+#define PT_WAITING 0
+#define PT_YIELDED 1
+#define PT_ENDED 3
+
+struct pt { unsigned short lc; };
+struct process {
+	struct process* next;
+	const char* name;
+	char (*thread)(struct pt*, process_event_t, process_data_t);
+	struct pt pt;
+	uint8_t running;
+	uint8_t polled;
+};
+
+#define PROCESS(name, strname) \
+	static char process_thread_##name(struct pt* process_pt, process_event_t ev, process_data_t data); \
+	struct process name = {0, strname, process_thread_##name}
+#define PROCESS_NAME(name) extern struct process name
+#define PROCESS_THREAD(name, ev, data) \
+	static char process_thread_##name(struct pt* process_pt, process_event_t ev, process_data_t data)
+#define PROCESS_BEGIN() { char pt_yield_flag = 1; if(pt_yield_flag) {;} switch(process_pt->lc) { case 0:
+#define PROCESS_END() } pt_yield_flag = 0; process_pt->lc = 0; return PT_ENDED; }
+#define PROCESS_WAIT_EVENT_UNTIL(c) do { pt_yield_flag = 0; process_pt->lc = __LINE__; case __LINE__: \
+	if(pt_yield_flag == 0 || !(c)) return PT_YIELDED; } while(0)
+#define PROCESS_WAIT_EVENT() PROCESS_WAIT_EVENT_UNTIL(1)
+#define PROCESS_YIELD() PROCESS_WAIT_EVENT()
+#define PROCESS_YIELD_UNTIL(c) PROCESS_WAIT_EVENT_UNTIL(c)
+#define PROCESS_PAUSE() do { process_poll(PROCESS_CURRENT()); PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL); } while(0)
+#define PROCESS_CURRENT() host_current_process
+#define AUTOSTART_PROCESSES(...) struct process* const autostart_processes[] = {__VA_ARGS__, 0}
+
+struct process* host_process_list = 0;
+struct process* host_current_process = 0;
+void (*host_after_step)() = 0; //called after each fired timer, e.g. for observing the state of the node
+
+//Calls the thread of the process with the event
+static void host_call_process(struct process* p, process_event_t ev, process_data_t data)
+{
+	struct process* caller = host_current_process;
+	if(p->running == 0) return;
+	host_current_process = p;
+	if(p->thread(&p->pt, ev, data) == PT_ENDED) p->running = 0;
+	host_current_process = caller;
+}
+
+void process_start(struct process* p, process_data_t data)
+{
+	struct process* q;
+	for(q=host_process_list; q!=0; q=q->next) if(q == p) return; //already started
+	p->next = host_process_list;
+	host_process_list = p;
+	p->pt.lc = 0;
+	p->running = 1;
+	p->polled = 0;
+	host_call_process(p, PROCESS_EVENT_INIT, data);
+}
+
+void process_poll(struct process* p)
+{
+	if(p != 0) p->polled = 1;
+}
+
+int process_post(struct process* p, process_event_t ev, process_data_t data)
+{
+	//delivered synchronously, which is sufficient for the library (it only posts to itself at the end of callbacks)
+	host_call_process(p, ev, data);
+	return 0;
+}
+
+process_event_t process_alloc_event()
+{
+	static process_event_t last = 0x10;
+	return last++;
+}
+
+//Number of pending polls (events are delivered synchronously)
+int process_nevents()
+{
+	int n = 0;
+	struct process* p;
+	for(p=host_process_list; p!=0; p=p->next) if(p->polled) n++;
+	return n;
+}
+
+//Delivers all pending polls. Returns 1 iff a process has been polled.
+uint8_t host_run_polls()
+{
+	uint8_t any = 0;
+	struct process* p;
+	for(p=host_process_list; p!=0; p=p->next) {
+		if(p->polled) {
+			p->polled = 0;
+			any = 1;
+			host_call_process(p, PROCESS_EVENT_POLL, 0);
+		}
+	}
+	return any;
+}
+//--PROCESSES--
+
+
+//**ETIMER**
+struct etimer {
+	clock_time_t start;
+	clock_time_t interval;
+	struct process* p;
+	uint8_t pending;
+	struct etimer* next;
+};
+struct etimer* host_etimer_list = 0;
+
+void etimer_stop(struct etimer* et)
+{
+	struct etimer** t;
+	for(t=&host_etimer_list; *t!=0; t=&((*t)->next)) {
+		if(*t == et) { *t = et->next; break; }
+	}
+	et->pending = 0;
+}
+
+void etimer_set(struct etimer* et, clock_time_t interval)
+{
+	etimer_stop(et);
+	et->start = host_now;
+	et->interval = interval;
+	et->p = PROCESS_CURRENT();
+	et->pending = 1;
+	et->next = host_etimer_list;
+	host_etimer_list = et;
+}
+
+void etimer_reset(struct etimer* et)
+{
+	clock_time_t start = et->start + et->interval;
+	etimer_set(et, et->interval);
+	et->start = start;
+}
+
+int etimer_expired(struct etimer* et) { return et->pending == 0; }
+clock_time_t etimer_expiration_time(struct etimer* et) { return et->start + et->interval; }
+int etimer_pending() { return host_etimer_list != 0; }
+clock_time_t etimer_next_expiration_time()
+{
+	clock_time_t next = 0;
+	struct etimer* t;
+	for(t=host_etimer_list; t!=0; t=t->next) {
+		if(next == 0 || etimer_expiration_time(t) < next) next = etimer_expiration_time(t);
+	}
+	return next;
+}
+//--ETIMER--
+
+#include "sys/ctimer.h"
+
+//**SCHEDULER**
+/**
+ * Runs all timers and polls that are due until the virtual time t (inclusive) and sets the time to t.
+ * Timers with equal expiration times fire in the order in which they have been set.
+ */
+void host_run_until(clock_time_t t)
+{
+	while(1) {
+		while(host_run_polls()) {}
+		struct etimer* next_et = 0;
+		struct etimer* e;
+		for(e=host_etimer_list; e!=0; e=e->next) {
+			if(next_et == 0 || etimer_expiration_time(e) <= etimer_expiration_time(next_et)) next_et = e;
+		}
+		struct ctimer* next_ct = host_next_ctimer();
+		clock_time_t et_time = next_et ? etimer_expiration_time(next_et) : (clock_time_t)-1;
+		clock_time_t ct_time = next_ct ? next_ct->expires : (clock_time_t)-1;
+		if(next_et == 0 && next_ct == 0) break;
+		if((et_time < ct_time ? et_time : ct_time) > t) break;
+		if(next_et != 0 && et_time <= ct_time) {
+			if(et_time > host_now) host_now = et_time;
+			etimer_stop(next_et);
+			host_call_process(next_et->p, PROCESS_EVENT_TIMER, next_et);
+		} else {
+			if(ct_time > host_now) host_now = ct_time;
+			host_fire_ctimer(next_ct);
+		}
+		if(host_after_step != 0) host_after_step();
+	}
+	if(t > host_now) host_now = t;
+}
+//--SCHEDULER--
+
+#endif
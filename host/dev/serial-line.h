@@ -0,0 +1,21 @@
+/**
+ * HOST SHIM of dev/serial-line.h (see ../contiki.h). Lines can be injected with host_serial_line().
+ */
+
+#ifndef SERIAL_LINE_H
+#define SERIAL_LINE_H
+
+#include "contiki.h"
+
+process_event_t serial_line_event_message = 0x90;
+
+//Delivers the line to all running processes like the serial line driver of Contiki
+void host_serial_line(char* line)
+{
+	struct process* p;
+	for(p=host_process_list; p!=0; p=p->next) {
+		host_call_process(p, serial_line_event_message, line);
+	}
+}
+
+#endif
@@ -0,0 +1,10 @@
+/**
+ * HOST SHIM of dev/watchdog.h (see ../contiki.h). There is no watchdog on the host.
+ */
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+void watchdog_periodic() {}
+
+#endif
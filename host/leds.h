@@ -0,0 +1,18 @@
+/**
+ * HOST SHIM of leds.h (see ./contiki.h). The state is kept in host_leds.
+ */
+
+#ifndef LEDS_H
+#define LEDS_H
+
+#define LEDS_GREEN 1
+#define LEDS_YELLOW 2
+#define LEDS_RED 4
+
+unsigned char host_leds = 0;
+
+void leds_init() { host_leds = 0; }
+void leds_on(unsigned char l) { host_leds |= l; }
+void leds_off(unsigned char l) { host_leds &= ~l; }
+
+#endif
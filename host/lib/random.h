@@ -0,0 +1,23 @@
+/**
+ * HOST SHIM of lib/random.h (see ../contiki.h). A deterministic 16 bit generator.
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#define RANDOM_RAND_MAX 65535U
+
+unsigned long host_random_state = 1;
+
+void random_init(unsigned short seed)
+{
+	host_random_state = seed;
+}
+
+unsigned short random_rand()
+{
+	host_random_state = host_random_state*1103515245UL + 12345UL;
+	return (unsigned short)((host_random_state >> 16) & 0xffff);
+}
+
+#endif
@@ -0,0 +1,41 @@
+/**
+ * Footprint probe for ../tools/mlst_footprint.py.
+ *
+ * This file is only compiled (-c), never run, so it also works with a cross compiler (avr-gcc). It includes the library
+ * for one variant (-DEA1/-DEA2/-DEA3, -DROOT and the optional feature flags) and exports the sizes of the structs that
+ * are allocated on the heap and the configured capacities as symbols, whose sizes (`nm -S`) are read by the tool:
+ *   footprint_sizeof_<name>: an array of sizeof(struct)+1 bytes
+ *   footprint_const_<name>: an array of value+1 bytes
+ * The static RAM and ROM of the modules are read from the sizes of the other global symbols of the object file.
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @licence MIT
+ */
+
+#include "contiki.h"
+#include "net/rime/rime.h"
+#include "lib/random.h"
+#include "leds.h"
+
+#pragma pack(push, 1)
+#if defined(EA1)
+#include "../mlst_network-ea1.h"
+#elif defined(EA2)
+#include "../mlst_network-ea2.h"
+#elif defined(EA3)
+#include "../mlst_network-ea3.h"
+#else
+#include "../mlst_network.h"
+#endif
+#pragma pack(pop)
+
+#define FOOTPRINT_SIZEOF(name, type) const uint8_t footprint_sizeof_##name[sizeof(type)+1] = {1};
+#define FOOTPRINT_CONST(name) const uint8_t footprint_const_##name[(name)+1] = {1};
+
+FOOTPRINT_SIZEOF(Nbr, struct Nbr)
+FOOTPRINT_SIZEOF(mlst_public_variable, struct mlst_public_variable)
+FOOTPRINT_SIZEOF(RSUnicastQueueElement, struct RSUnicastQueueElement)
+FOOTPRINT_SIZEOF(rsu_history_element, struct rsu_history_element)
+FOOTPRINT_SIZEOF(pointer, void*)
+FOOTPRINT_CONST(MAX_HISTORY_SIZE)
+FOOTPRINT_CONST(RSU_HEADER_SIZE)
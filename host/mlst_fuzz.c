@@ -0,0 +1,142 @@
+/**
+ * Fuzzing harness for the receive paths of the PVN (on_new_neighbor_information) and rsunicast (rsu_on_new_message,
+ * rsu_on_recieve_ack).
+ *
+ * An input is a sequence of operations. Each operation starts with a byte op:
+ *   op%4 == 0: frame on the PVN port of the MLST, 1: frame on the data port, 2: frame on the ACK port
+ *              followed by the sender (1 byte), the length (1 byte, modulo PACKETBUF_SIZE+1) and the payload (truncated
+ *              at the end of the input)
+ *              (with RSUNICAST_OPPORTUNISTIC, op%8 == 6 is a frame on the port of the candidates and claims instead)
+ *   op%4 == 3: lets the node run for (op/4) eighths of a second (timers, MLST periods, retries, aging)
+ * The node keeps its state between inputs, like a node that receives garbage over a long time.
+ * The packetbuf of the host shim is strict (HOST_STRICT_PACKETBUF), so reading beyond the length of a frame is reported
+ * by AddressSanitizer.
+ *
+ * Build with libFuzzer (clang):
+ *   clang -std=gnu99 -g -fsanitize=fuzzer,address,undefined -fno-sanitize=alignment -DMLST_FUZZ_LIBFUZZER -I host -o mlst_fuzz host/mlst_fuzz.c
+ *   ASAN_OPTIONS=detect_leaks=0 ./mlst_fuzz corpus/
+ * Build without libFuzzer (gcc), then it runs the given input files or N random inputs:
+ *   gcc -std=gnu99 -g -fsanitize=address,undefined -fno-sanitize=alignment -I host -o mlst_fuzz host/mlst_fuzz.c
+ *   ASAN_OPTIONS=detect_leaks=0 ./mlst_fuzz -n 100000 [seed]     or     ./mlst_fuzz crash-input
+ * Add -DEA1/-DEA2/-DEA3 for the energy aware forks and -DROOT for the root.
+ * The structs are packed like on INGA, thus alignment checks and the leak detection (which does not find unaligned
+ * pointers) have to be disabled.
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @licence MIT
+ */
+
+#define HOST_STRICT_PACKETBUF
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "contiki.h"
+#include "net/rime/rime.h"
+#include "lib/random.h"
+#include "leds.h"
+
+#pragma pack(push, 1)
+#if defined(EA1)
+#include "../mlst_network-ea1.h"
+#elif defined(EA2)
+#include "../mlst_network-ea2.h"
+#elif defined(EA3)
+#include "../mlst_network-ea3.h"
+#else
+#include "../mlst_network.h"
+#endif
+#pragma pack(pop)
+
+static const uint16_t fuzz_ports[3] = {MLST_PVN_PORT, MESSAGING_PORT, ACKNOWLEDGEMENT_PORT};
+
+#ifdef ROOT
+static void fuzz_on_root_message(void* msg, uint16_t size)
+{
+	//touch every byte, so a wrong size is detected
+	volatile uint8_t sum = 0;
+	uint16_t i;
+	for(i=0; i<size; i++) sum += ((uint8_t*)msg)[i];
+}
+#endif
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	static uint8_t is_initialized = 0;
+	size_t i = 0;
+	if(is_initialized == 0) {
+		linkaddr_node_addr.u8[0] = 0;
+		linkaddr_node_addr.u8[1] = 1;
+		mlst_init();
+#ifdef ROOT
+		rsunicast_setNewMessageCallback_root(fuzz_on_root_message);
+#endif
+		is_initialized = 1;
+	}
+	while(i < size) {
+		uint8_t op = data[i++];
+		if(op%4 == 3) {
+			host_run_until(clock_time() + (op/4)*CLOCK_SECOND/8);
+			continue;
+		}
+		if(i+2 > size) break;
+		uint16_t from = data[i];
+		uint16_t len = data[i+1]%(PACKETBUF_SIZE+1);
+		i += 2;
+		if(len > size-i) len = size-i;
+#ifdef RSUNICAST_OPPORTUNISTIC
+		host_receive(op%8 == 6 ? RSU_OPP_PORT : fuzz_ports[op%4], from, data+i, len);
+#else
+		host_receive(fuzz_ports[op%4], from, data+i, len);
+#endif
+		i += len;
+	}
+	return 0;
+}
+
+#ifndef MLST_FUZZ_LIBFUZZER
+//Generates a random input in which about half of the frames have the length the handlers expect
+static size_t fuzz_random_input(uint8_t* buf, size_t max)
+{
+	size_t n = 0;
+	uint8_t ops = 1 + rand()%8;
+	while(ops-- > 0 && n+3 < max) {
+		uint8_t op = rand()%256;
+		buf[n++] = op;
+		if(op%4 == 3) continue;
+		uint8_t len = rand()%2 ? rand()%40 : (op%4 == 0 ? PVN_HEADER_SIZE+sizeof(struct mlst_public_variable) : (op%4 == 1 ? RSU_HEADER_SIZE+rand()%8 : RSU_ACK_SIZE));
+		buf[n++] = rand()%16; //few senders, so neighbors and history entries are hit again
+		buf[n++] = len;
+		while(len-- > 0 && n < max) buf[n++] = rand()%4 ? rand()%4 : rand()%256; //small values hit more branches
+	}
+	return n;
+}
+
+int main(int argc, char** argv)
+{
+	static uint8_t buf[4096];
+	unsigned long runs = 0, i;
+	int a;
+	if(freopen("/dev/null", "w", stdout) == 0) return 1; //the library prints a lot
+	if(argc >= 3 && strcmp(argv[1], "-n") == 0) {
+		unsigned long n = strtoul(argv[2], 0, 10);
+		srand(argc > 3 ? strtoul(argv[3], 0, 10) : 1);
+		for(i=0; i<n; i++) {
+			LLVMFuzzerTestOneInput(buf, fuzz_random_input(buf, sizeof(buf)));
+		}
+		runs = n;
+	} else {
+		for(a=1; a<argc; a++) {
+			FILE* f = fopen(argv[a], "rb");
+			if(f == 0) { perror(argv[a]); return 1; }
+			size_t size = fread(buf, 1, sizeof(buf), f);
+			fclose(f);
+			LLVMFuzzerTestOneInput(buf, size);
+			runs++;
+		}
+	}
+	fprintf(stderr, "%lu inputs without errors (time %lus, queue %u, neighbors %u)\n", runs, clock_seconds(),
+			rsu_messages_in_queue, pvn_neighborhood_size(&mlst_pvn));
+	return 0;
+}
+#endif
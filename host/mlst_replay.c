@@ -0,0 +1,171 @@
+/**
+ * Deterministic replay of a recorded run (see ../trace/record.h) through the PVN, MLST and rsunicast code.
+ *
+ * The recording is the raw serial output of a node that has been built with MLST_RECORD (printf output and trace records
+ * in between are skipped). The replay starts the node with the recorded id at its recorded boot time, injects every
+ * recorded frame at its recorded time and lets the timers of the node run in virtual time in between (see ./contiki.h).
+ * Frames that arrive while the replayed node has closed the corresponding channel are dropped, as they would be on the
+ * real node.
+ *
+ * The output is the state trajectory: a line whenever the public variable, the online states, the queue length or the
+ * neighborhood size changes and a line for every sent frame. Two replays of the same recording with the same code are
+ * bit-identical, so `diff` of two outputs shows exactly where an algorithm change (e.g. in mlst_recalculate) behaves
+ * differently on the same input.
+ *
+ * Build (from the repository root, add -DEA1/-DEA2/-DEA3 for the energy aware forks and -DROOT for the root):
+ *   gcc -std=gnu99 -I host -o mlst_replay host/mlst_replay.c
+ * Usage:
+ *   ./mlst_replay recording.bin [seconds to run after the last frame, default 30] > trajectory.txt
+ *
+ * The structs of the library are packed like on the 8 bit INGA nodes, so the public variables of the recording can be
+ * used as they are.
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @licence MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "contiki.h"
+#include "net/rime/rime.h"
+#include "lib/random.h"
+#include "leds.h"
+
+#pragma pack(push, 1)
+#if defined(EA1)
+#include "../mlst_network-ea1.h"
+#elif defined(EA2)
+#include "../mlst_network-ea2.h"
+#elif defined(EA3)
+#include "../mlst_network-ea3.h"
+#else
+#include "../mlst_network.h"
+#endif
+#pragma pack(pop)
+
+//A recorded frame
+struct replay_frame {
+	uint16_t port;
+	unsigned long time;
+	uint16_t from;
+	uint8_t length;
+	uint8_t payload[256];
+};
+
+/**
+ * Reads the next valid frame from the raw serial stream. Returns 1 on success, 0 at the end of the file.
+ */
+static uint8_t replay_read_frame(FILE* f, struct replay_frame* fr)
+{
+	int c;
+	while((c = fgetc(f)) != EOF) {
+		if(c != RECORD_START_BYTE) continue;
+		long pos = ftell(f);
+		uint8_t header[9];
+		uint8_t checksum = 0, i;
+		if(fread(header, 1, sizeof(header), f) != sizeof(header)) return 0;
+		for(i=0; i<sizeof(header); i++) checksum ^= header[i];
+		fr->port = header[0] | header[1]<<8;
+		fr->time = header[2] | header[3]<<8 | (unsigned long)header[4]<<16 | (unsigned long)header[5]<<24;
+		fr->from = header[6] | header[7]<<8;
+		fr->length = header[8];
+		if(fread(fr->payload, 1, fr->length, f) == fr->length && (c = fgetc(f)) != EOF) {
+			for(i=0; i<fr->length; i++) checksum ^= fr->payload[i];
+			if(checksum == (uint8_t)c) return 1;
+		}
+		fseek(f, pos, SEEK_SET); //no valid frame, resynchronize after the start byte
+	}
+	return 0;
+}
+
+//**TRAJECTORY OUTPUT**
+static struct mlst_public_variable last_pv;
+static int last_online = -1, last_rsu_online = -1, last_queue = -1, last_nbrs = -1;
+
+//Prints the state of the node if it has changed since the last call
+static void replay_print_state()
+{
+	int nbrs = pvn_neighborhood_size(&mlst_pvn);
+	if(memcmp(&last_pv, &own_mlst_public_variable, sizeof(last_pv)) == 0 && last_online == pvn_is_online(&mlst_pvn)
+			&& last_rsu_online == rsu_is_online && last_queue == rsu_messages_in_queue && last_nbrs == nbrs) {
+		return;
+	}
+	memcpy(&last_pv, &own_mlst_public_variable, sizeof(last_pv));
+	last_online = pvn_is_online(&mlst_pvn);
+	last_rsu_online = rsu_is_online;
+	last_queue = rsu_messages_in_queue;
+	last_nbrs = nbrs;
+	printf("%lu STATE pv=", clock_time());
+	unsigned int i;
+	for(i=0; i<sizeof(last_pv); i++) printf("%02x", ((uint8_t*)&last_pv)[i]);
+	printf(" parent=%u children=%u pvn=%s rsu=%s queue=%d nbrs=%d\n", own_mlst_public_variable.parent_id,
+			own_mlst_public_variable.children_count, last_online ? "on" : "off", last_rsu_online ? "on" : "off", last_queue, nbrs);
+}
+
+static void replay_on_send(uint16_t port, const linkaddr_t* to, const void* data, uint16_t len)
+{
+	uint16_t i;
+	printf("%lu TX port=%u to=%u data=", clock_time(), port, to ? (to->u8[0]<<8 | to->u8[1]) : 0xffff);
+	for(i=0; i<len; i++) printf("%02x", ((const uint8_t*)data)[i]);
+	printf("\n");
+}
+//--TRAJECTORY OUTPUT--
+
+#ifdef ROOT
+static void replay_on_root_message(void* msg, uint16_t size)
+{
+	printf("%lu ROOT-RECEIVED size=%u\n", clock_time(), size);
+}
+#endif
+
+int main(int argc, char** argv)
+{
+	struct replay_frame fr;
+	unsigned long clock_second = CLOCK_SECOND;
+	unsigned long tail = 30;
+	uint8_t started = 0;
+
+	if(argc < 2) {
+		fprintf(stderr, "usage: %s recording [seconds after the last frame]\n", argv[0]);
+		return 1;
+	}
+	FILE* f = fopen(argv[1], "rb");
+	if(f == 0) { perror(argv[1]); return 1; }
+	if(argc > 2) tail = strtoul(argv[2], 0, 10);
+
+	host_on_send = replay_on_send;
+	host_after_step = replay_print_state;
+	while(replay_read_frame(f, &fr)) {
+		if(fr.port == 0) { //header: own id and clock rate
+			if(started) continue; //only the first boot is replayed
+			linkaddr_node_addr.u8[0] = fr.from >> 8;
+			linkaddr_node_addr.u8[1] = fr.from & 0xff;
+			if(fr.length >= 2) clock_second = fr.payload[0] | fr.payload[1]<<8;
+			//the node starts at its recorded boot time, thus its timers keep their phase to the recorded frames
+			host_run_until(fr.time*CLOCK_SECOND/clock_second);
+			printf("%lu BOOT id=%u\n", clock_time(), fr.from);
+			mlst_init();
+#ifdef ROOT
+			rsunicast_setNewMessageCallback_root(replay_on_root_message);
+#endif
+			started = 1;
+			replay_print_state();
+			continue;
+		}
+		if(started == 0) continue;
+		host_run_until(fr.time*CLOCK_SECOND/clock_second);
+		uint8_t delivered = host_receive(fr.port, fr.from, fr.payload, fr.length);
+		printf("%lu RX port=%u from=%u len=%u%s\n", clock_time(), fr.port, fr.from, fr.length, delivered ? "" : " dropped");
+		replay_print_state();
+	}
+	fclose(f);
+	if(started == 0) {
+		fprintf(stderr, "no boot frame in %s (was the node built with MLST_RECORD?)\n", argv[1]);
+		return 1;
+	}
+	host_run_until(clock_time() + tail*CLOCK_SECOND);
+	mlst_print_state();
+	rsunicast_print_state();
+	return 0;
+}
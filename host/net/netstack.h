@@ -0,0 +1,24 @@
+/**
+ * HOST SHIM of net/netstack.h (see ../contiki.h)
+ *
+ * Only the on/off switch of the radio duty cycling layer, used by ../../radio_power/radio_power.h. While the radio is
+ * off, host_receive() drops all frames.
+ */
+
+#ifndef NETSTACK_H
+#define NETSTACK_H
+
+#include "contiki.h"
+
+uint8_t host_radio_on = 1; //Contiki starts with the radio on
+
+static int host_rdc_on(void) { host_radio_on = 1; return 1; }
+static int host_rdc_off(int keep_radio_on) { host_radio_on = keep_radio_on ? 1 : 0; return 1; }
+
+struct rdc_driver {
+	int (*on)(void);
+	int (*off)(int keep_radio_on);
+};
+const struct rdc_driver NETSTACK_RDC = {host_rdc_on, host_rdc_off};
+
+#endif
@@ -0,0 +1,153 @@
+/**
+ * HOST SHIM of net/rime/rime.h (see ../../contiki.h)
+ *
+ * Implements linkaddr, packetbuf and the broadcast/unicast primitives of Rime for a single node. Sent frames are passed
+ * to host_on_send (if set), received frames are injected with host_receive() which calls the callback of the open
+ * connection on that port like Rime would.
+ */
+
+#ifndef RIME_H
+#define RIME_H
+
+#include "contiki.h"
+#include "net/netstack.h"
+
+//**LINKADDR**
+typedef union {
+	unsigned char u8[2];
+	uint16_t u16;
+} linkaddr_t;
+linkaddr_t linkaddr_node_addr;
+const linkaddr_t linkaddr_null = {{0, 0}};
+
+void linkaddr_copy(linkaddr_t* dest, const linkaddr_t* src) { memcpy(dest, src, sizeof(linkaddr_t)); }
+int linkaddr_cmp(const linkaddr_t* a, const linkaddr_t* b) { return memcmp(a, b, sizeof(linkaddr_t)) == 0; }
+void linkaddr_set_node_addr(linkaddr_t* addr) { linkaddr_copy(&linkaddr_node_addr, addr); }
+//--LINKADDR--
+
+
+//**PACKETBUF**
+//With HOST_STRICT_PACKETBUF the data is placed at the end of the buffer, so reading beyond packetbuf_datalen() is an
+//overflow of host_packetbuf that AddressSanitizer detects (see ../../mlst_fuzz.c).
+#define PACKETBUF_SIZE 128
+uint8_t host_packetbuf[PACKETBUF_SIZE];
+uint16_t host_packetbuf_len = 0;
+uint16_t host_packetbuf_offset = 0; //start of the data in host_packetbuf
+
+void packetbuf_clear() { host_packetbuf_len = 0; host_packetbuf_offset = 0; }
+void* packetbuf_dataptr() { return host_packetbuf + host_packetbuf_offset; }
+uint16_t packetbuf_datalen() { return host_packetbuf_len; }
+void packetbuf_set_datalen(uint16_t len) { host_packetbuf_len = len; }
+
+//Only the attributes used by the library. Set host_packetbuf_attrs before injecting a frame to simulate them.
+#define PACKETBUF_ATTR_RSSI 0
+#define PACKETBUF_ATTR_LINK_QUALITY 1
+typedef uint16_t packetbuf_attr_t;
+packetbuf_attr_t host_packetbuf_attrs[2];
+packetbuf_attr_t packetbuf_attr(uint8_t type) { return host_packetbuf_attrs[type]; }
+int packetbuf_copyfrom(const void* from, uint16_t len)
+{
+	if(len > PACKETBUF_SIZE) len = PACKETBUF_SIZE;
+#ifdef HOST_STRICT_PACKETBUF
+	host_packetbuf_offset = PACKETBUF_SIZE - len;
+#endif
+	memcpy(host_packetbuf + host_packetbuf_offset, from, len);
+	host_packetbuf_len = len;
+	return len;
+}
+//--PACKETBUF--
+
+
+//**CONNECTIONS**
+struct broadcast_conn;
+struct unicast_conn;
+struct broadcast_callbacks {
+	void (*recv)(struct broadcast_conn* c, const linkaddr_t* from);
+	void (*sent)(struct broadcast_conn* c, int status, int num_tx);
+};
+struct unicast_callbacks {
+	void (*recv)(struct unicast_conn* c, const linkaddr_t* from);
+	void (*sent)(struct unicast_conn* c, int status, int num_tx);
+};
+struct broadcast_conn {
+	uint16_t port;
+	const struct broadcast_callbacks* u;
+	const struct unicast_callbacks* uu; //set iff this is the base of a unicast_conn
+	struct broadcast_conn* next;
+};
+struct unicast_conn {
+	struct broadcast_conn c;
+};
+
+struct broadcast_conn* host_open_conns = 0;
+//Called for each sent frame. to is 0 for broadcasts.
+void (*host_on_send)(uint16_t port, const linkaddr_t* to, const void* data, uint16_t len) = 0;
+
+static void host_conn_close(struct broadcast_conn* c)
+{
+	struct broadcast_conn** t;
+	for(t=&host_open_conns; *t!=0; t=&((*t)->next)) {
+		if(*t == c) { *t = c->next; return; }
+	}
+}
+
+static void host_conn_open(struct broadcast_conn* c, uint16_t port)
+{
+	host_conn_close(c);
+	c->port = port;
+	c->next = host_open_conns;
+	host_open_conns = c;
+}
+
+void broadcast_open(struct broadcast_conn* c, uint16_t port, const struct broadcast_callbacks* u)
+{
+	host_conn_open(c, port);
+	c->u = u;
+	c->uu = 0;
+}
+void broadcast_close(struct broadcast_conn* c) { host_conn_close(c); }
+int broadcast_send(struct broadcast_conn* c)
+{
+	if(host_on_send != 0) host_on_send(c->port, 0, packetbuf_dataptr(), host_packetbuf_len);
+	return 1;
+}
+
+void unicast_open(struct unicast_conn* c, uint16_t port, const struct unicast_callbacks* u)
+{
+	host_conn_open(&c->c, port);
+	c->c.u = 0;
+	c->c.uu = u;
+}
+void unicast_close(struct unicast_conn* c) { host_conn_close(&c->c); }
+int unicast_send(struct unicast_conn* c, const linkaddr_t* to)
+{
+	if(host_on_send != 0) host_on_send(c->c.port, to, packetbuf_dataptr(), host_packetbuf_len);
+	return 1;
+}
+
+/**
+ * Delivers a frame as if it had been received on the port from the node with the id.
+ * Returns 1 iff the radio is on and a connection on this port is open (otherwise the frame is lost as on a sleeping node).
+ */
+uint8_t host_receive(uint16_t port, uint16_t from, const void* data, uint16_t len)
+{
+	struct broadcast_conn* c;
+	linkaddr_t sender;
+	if(host_radio_on == 0) return 0;
+	sender.u8[0] = from >> 8;
+	sender.u8[1] = from & 0xff;
+	for(c=host_open_conns; c!=0; c=c->next) {
+		if(c->port != port) continue;
+		packetbuf_copyfrom(data, len);
+		if(c->uu != 0) {
+			if(c->uu->recv != 0) c->uu->recv((struct unicast_conn*) c, &sender);
+		} else if(c->u != 0 && c->u->recv != 0) {
+			c->u->recv(c, &sender);
+		}
+		return 1;
+	}
+	return 0;
+}
+//--CONNECTIONS--
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * HOST SHIM of sys/ctimer.h (see ../contiki.h)
+ */
+
+#ifndef CTIMER_H
+#define CTIMER_H
+
+#include "contiki.h"
+
+struct ctimer {
+	clock_time_t expires;
+	void (*f)(void*);
+	void* ptr;
+	uint8_t pending;
+	unsigned long order; //for firing timers with the same expiration time in the order of setting
+	struct ctimer* next;
+};
+struct ctimer* host_ctimer_list = 0;
+unsigned long host_ctimer_order = 0;
+
+void ctimer_stop(struct ctimer* c)
+{
+	struct ctimer** t;
+	for(t=&host_ctimer_list; *t!=0; t=&((*t)->next)) {
+		if(*t == c) { *t = c->next; break; }
+	}
+	c->pending = 0;
+}
+
+void ctimer_set(struct ctimer* c, clock_time_t t, void (*f)(void*), void* ptr)
+{
+	ctimer_stop(c);
+	c->expires = host_now + t;
+	c->f = f;
+	c->ptr = ptr;
+	c->pending = 1;
+	c->order = host_ctimer_order++;
+	c->next = host_ctimer_list;
+	host_ctimer_list = c;
+}
+
+int ctimer_expired(struct ctimer* c) { return c->pending == 0; }
+
+//Returns the ctimer that expires next or 0
+struct ctimer* host_next_ctimer()
+{
+	struct ctimer* next = 0;
+	struct ctimer* c;
+	for(c=host_ctimer_list; c!=0; c=c->next) {
+		if(next == 0 || c->expires < next->expires || (c->expires == next->expires && c->order < next->order)) next = c;
+	}
+	return next;
+}
+
+void host_fire_ctimer(struct ctimer* c)
+{
+	ctimer_stop(c);
+	c->f(c->ptr);
+}
+
+#endif
@@ -0,0 +1,178 @@
+/**
+ * MODULE OF mlst_network.h (and mlst_network-ea2.h)
+ *
+ * Traffic load as secondary criterion of the parent selection (`#define MLST_LOAD_AWARE`). Without it a node chooses
+ * among the potential parents with the same distance the one with the most children (the leaf maximizing rule) and on a
+ * tie the one with the lowest id, thus a hotspot can relay most of the traffic while an equivalent neighbor idles.
+ *
+ * Every node measures the rate of the messages it forwards (messages per minute, averaged over windows of
+ * LOAD_AWARE_WINDOW seconds) and advertises it together with the length of its queue in the public variable. The load
+ * is the rate plus LOAD_AWARE_QUEUE_WEIGHT per waiting message. A potential parent is preferred to another one with the
+ * same distance if it is less loaded by more than LOAD_AWARE_MARGIN and has at most LOAD_AWARE_NEAR_TIE fewer children.
+ * It is not preferred if it has no children besides this node while the other one has (see mlst_load_prefers): it would
+ * become backbone while the other one stays backbone. As the counts of the neighbors lag behind, this node is assumed to
+ * be counted by its current parent and for LOAD_AWARE_HOLD seconds after a change also by the last one
+ * (load_aware_counts_me). Thus, as far as the advertised counts are right, the number of leaves is not reduced: a node
+ * only becomes backbone because of the load if the current parent becomes a leaf instead.
+ * The load of the current parent includes the own traffic, which is subtracted before the comparison. Otherwise the
+ * node would switch back and forth between two parents. The load is not covered by the change detection and the digest
+ * of the MLST, thus it does not wake up the leaves.
+ *
+ * User Functions:
+ * ---------------------------
+ * void load_aware_update(uint16_t enqueued, uint16_t forwarded, uint16_t queue_length); //Measures the rates. Called once per period.
+ * void load_aware_parent_changed(uint16_t old_parent); //Remembers the last parent. Called by mlst_recalculate.
+ * uint8_t load_aware_counts_me(uint16_t id, uint16_t parent); //1 iff the neighbor may count this node as child
+ * uint8_t load_aware_forward_rate(); //Forwarded messages per minute (advertised)
+ * uint8_t load_aware_queue_depth(); //Length of the queue (advertised)
+ * uint8_t load_aware_own_rate(); //Messages per minute this node sends to its parent (own and forwarded ones)
+ * uint16_t load_aware_load(uint8_t forward_rate, uint8_t queue_depth); //The load of a neighbor
+ * uint8_t load_aware_prefers(uint16_t a_load, uint8_t a_children, uint16_t b_load, uint8_t b_children); //1 iff a is clearly less loaded
+ * void load_aware_print_state(); //Prints the rates and the queue depth
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef LOAD_AWARE_H
+#define LOAD_AWARE_H
+
+#include "contiki.h"
+#include <stdio.h>
+
+#ifdef MLST_LOAD_AWARE
+
+//Length of the measuring window in seconds
+#ifndef LOAD_AWARE_WINDOW
+#define LOAD_AWARE_WINDOW 30
+#endif
+//A waiting message counts as much as this number of forwarded messages per minute
+#ifndef LOAD_AWARE_QUEUE_WEIGHT
+#define LOAD_AWARE_QUEUE_WEIGHT 4
+#endif
+//A potential parent has to be less loaded by more than this to be preferred
+#ifndef LOAD_AWARE_MARGIN
+#define LOAD_AWARE_MARGIN 6
+#endif
+//Difference of the number of children that is considered as a near tie
+#ifndef LOAD_AWARE_NEAR_TIE
+#define LOAD_AWARE_NEAR_TIE 1
+#endif
+//Time in seconds after a change of the parent in which the last parent is assumed to count this node as child
+#ifndef LOAD_AWARE_HOLD
+#define LOAD_AWARE_HOLD 5
+#endif
+
+//**VARIABLES**
+uint8_t load_aware_forwarded_per_minute = 0; //averaged rate of forwarded messages
+uint8_t load_aware_enqueued_per_minute = 0; //averaged rate of own and forwarded messages
+uint8_t load_aware_queue = 0; //length of the queue at the last period
+unsigned long load_aware_window_start = 0; //clock_seconds() of the begin of the window
+uint16_t load_aware_enqueued_at_start = 0;
+uint16_t load_aware_forwarded_at_start = 0;
+uint16_t load_aware_last_parent = 0; //the last defined parent before the current one
+unsigned long load_aware_changed_at = 0; //clock_seconds() of the last change of the parent
+//--VARIABLES--
+
+//Returns the average of the old rate and the count of the window (in messages per minute, saturated)
+static uint8_t load_aware_average(uint8_t rate, uint16_t count, unsigned long seconds)
+{
+	unsigned long per_minute = ((unsigned long) count)*60/seconds;
+	per_minute = (per_minute + rate)/2;
+	return per_minute < 0xff ? per_minute : 0xff;
+}
+
+/**
+ * Measures the rates with the counters of rsunicast (rsu_messages_enqueued, rsu_messages_forwarded) and keeps the length
+ * of the queue. Called once per period.
+ */
+void load_aware_update(uint16_t enqueued, uint16_t forwarded, uint16_t queue_length)
+{
+	unsigned long seconds = clock_seconds() - load_aware_window_start;
+	load_aware_queue = queue_length < 0xff ? queue_length : 0xff;
+	if(seconds < LOAD_AWARE_WINDOW) return;
+	load_aware_enqueued_per_minute = load_aware_average(load_aware_enqueued_per_minute,
+			(uint16_t)(enqueued - load_aware_enqueued_at_start), seconds);
+	load_aware_forwarded_per_minute = load_aware_average(load_aware_forwarded_per_minute,
+			(uint16_t)(forwarded - load_aware_forwarded_at_start), seconds);
+	load_aware_window_start = clock_seconds();
+	load_aware_enqueued_at_start = enqueued;
+	load_aware_forwarded_at_start = forwarded;
+}
+
+/**
+ * Remembers the last parent (an undefined one is skipped) and the time of the change.
+ */
+void load_aware_parent_changed(uint16_t old_parent)
+{
+	if(old_parent != 0) load_aware_last_parent = old_parent;
+	load_aware_changed_at = clock_seconds();
+}
+
+/**
+ * Returns 1 iff the advertised children count of the neighbor may include this node: the current parent and for
+ * LOAD_AWARE_HOLD seconds after a change the last parent (its count may be older than the change).
+ */
+uint8_t load_aware_counts_me(uint16_t id, uint16_t parent)
+{
+	if(id == parent) return 1;
+	return clock_seconds() - load_aware_changed_at < LOAD_AWARE_HOLD && id == load_aware_last_parent;
+}
+
+/**
+ * Returns the rate of the forwarded messages in messages per minute.
+ */
+uint8_t load_aware_forward_rate()
+{
+	return load_aware_forwarded_per_minute;
+}
+
+/**
+ * Returns the length of the queue.
+ */
+uint8_t load_aware_queue_depth()
+{
+	return load_aware_queue;
+}
+
+/**
+ * Returns the rate of the messages this node sends to its parent (own and forwarded ones) in messages per minute. It is
+ * part of the load of the parent.
+ */
+uint8_t load_aware_own_rate()
+{
+	return load_aware_enqueued_per_minute;
+}
+
+/**
+ * Returns the load of a neighbor with the advertised values.
+ */
+uint16_t load_aware_load(uint8_t forward_rate, uint8_t queue_depth)
+{
+	return forward_rate + LOAD_AWARE_QUEUE_WEIGHT*(uint16_t)queue_depth;
+}
+
+/**
+ * Returns 1 iff the potential parent a is clearly less loaded than b and has at most LOAD_AWARE_NEAR_TIE fewer children.
+ * The caller has to check that a does not become backbone only because of this node.
+ */
+uint8_t load_aware_prefers(uint16_t a_load, uint8_t a_children, uint16_t b_load, uint8_t b_children)
+{
+	if(a_children + LOAD_AWARE_NEAR_TIE < b_children) return 0;
+	return a_load + LOAD_AWARE_MARGIN < b_load;
+}
+
+/**
+ * Prints the advertised values and the own rate, e.g.
+ * LOAD_AWARE[forwarded=14/min, queue=2, own=16/min]
+ */
+void load_aware_print_state()
+{
+	printf("LOAD_AWARE[forwarded=%u/min, queue=%u, own=%u/min]\n", load_aware_forwarded_per_minute, load_aware_queue,
+			load_aware_enqueued_per_minute);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,149 @@
+/**
+ * MODULE OF mlst_network.h (and its energy aware forks)
+ *
+ * Here the tuning parameters of the MLST are defined. All of them can be overridden at compile time (e.g.
+ * `CFLAGS += -DMAX_AGE_OF_PARENT=8`).
+ *
+ * Runtime Configuration
+ * ----------------------------
+ * If `MLST_RUNTIME_CONFIG` is defined, the values below are only the defaults and can be changed at runtime, which is
+ * meant for host builds (e.g. Cooja motes) so one firmware can be used for a whole parameter sweep (./tools/mlst_sweep.py).
+ * The parameters are set via lines of the form `NAME=VALUE` on the serial port, where NAME is the name of the define, e.g.
+ * `MAX_AGE_OF_PARENT=8` or `TIMEOUT_IN_SEC=0.3`. The rsunicast parameters (TIMEOUT_IN_SEC, MAX_TRIES) are accepted as well.
+ * It costs some bytes of RAM and atof(), so do not use it on the real nodes.
+ *
+ * User Functions (only with MLST_RUNTIME_CONFIG):
+ * ----------------------------
+ * uint8_t mlst_set_parameter(const char* name, float value); //Sets a parameter by the name of its define. 1 on success.
+ * uint8_t mlst_parse_parameter(const char* line); //Parses and sets a 'NAME=VALUE' line. 1 on success.
+ * void mlst_print_config(); //Prints all current values
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef MLST_CONFIG_H
+#define MLST_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//After this time without refreshment neighbor-entries are deleted
+#ifndef MAX_AGE_OF_MLST_NBR_IN_SECONDS
+#define MAX_AGE_OF_MLST_NBR_IN_SECONDS 15
+#endif
+//The length of a period in the calculation. In each period a while-loop with the MLST Calculation is executed as well as the state broadcasted. It will be randomized a little.
+#ifndef MLST_PERIOD_LENGTH_IN_SECONDS
+#define MLST_PERIOD_LENGTH_IN_SECONDS 1
+#endif
+//If there has been a change, the node is not going to sleep even if it is a leaf for this amount of periods
+#ifndef IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS
+#define IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS 3
+#endif
+//the maximal age of the parent neighbor entry in seconds. It will stay awake if it is too old until the entry is updated.
+#ifndef MAX_AGE_OF_PARENT
+#define MAX_AGE_OF_PARENT 5
+#endif
+//The period in ticks, converted by the compiler (the timers are set without floating point arithmetic)
+#define MLST_PERIOD_TICKS ((clock_time_t)(MLST_PERIOD_LENGTH_IN_SECONDS*CLOCK_SECOND))
+
+
+#ifdef MLST_RUNTIME_CONFIG
+#include "dev/serial-line.h"
+
+//The current values of the parameters. Initialized with the defaults above.
+struct mlst_config {
+	uint8_t max_age_of_nbr_in_seconds;
+	float period_length_in_seconds;
+	clock_time_t period_ticks; //converted when it is set
+	uint8_t stay_active_for_n_periods;
+	uint8_t max_age_of_parent;
+};
+struct mlst_config mlst_config = {MAX_AGE_OF_MLST_NBR_IN_SECONDS, MLST_PERIOD_LENGTH_IN_SECONDS, MLST_PERIOD_TICKS,
+		IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS, MAX_AGE_OF_PARENT};
+
+//From now on the defines refer to the runtime values
+#undef MAX_AGE_OF_MLST_NBR_IN_SECONDS
+#define MAX_AGE_OF_MLST_NBR_IN_SECONDS (mlst_config.max_age_of_nbr_in_seconds)
+#undef MLST_PERIOD_LENGTH_IN_SECONDS
+#define MLST_PERIOD_LENGTH_IN_SECONDS (mlst_config.period_length_in_seconds)
+#undef MLST_PERIOD_TICKS
+#define MLST_PERIOD_TICKS (mlst_config.period_ticks)
+#undef IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS
+#define IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS (mlst_config.stay_active_for_n_periods)
+#undef MAX_AGE_OF_PARENT
+#define MAX_AGE_OF_PARENT (mlst_config.max_age_of_parent)
+
+struct PVN;
+extern struct PVN mlst_pvn; //defined by the including mlst_network header
+void pvn_set_max_age(struct PVN* pvn, uint8_t maxAge); //preliminary definition (./public_variable_neighborhood/public_variable_neighborhood.h)
+uint8_t rsunicast_set_parameter(const char* name, float value); //preliminary definition (./rsunicast/rsunicast.h)
+
+/**
+ * Sets the parameter with the name of its define to value.
+ * Returns 1 on success and 0 if the name is unknown.
+ */
+uint8_t mlst_set_parameter(const char* name, float value)
+{
+	if(strcmp(name, "MAX_AGE_OF_MLST_NBR_IN_SECONDS")==0) {
+		mlst_config.max_age_of_nbr_in_seconds = (uint8_t)value;
+		pvn_set_max_age(&mlst_pvn, mlst_config.max_age_of_nbr_in_seconds);
+	} else if(strcmp(name, "MLST_PERIOD_LENGTH_IN_SECONDS")==0) {
+		mlst_config.period_length_in_seconds = value;
+		mlst_config.period_ticks = (clock_time_t)(value*CLOCK_SECOND);
+	} else if(strcmp(name, "IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS")==0) {
+		mlst_config.stay_active_for_n_periods = (uint8_t)value;
+	} else if(strcmp(name, "MAX_AGE_OF_PARENT")==0) {
+		mlst_config.max_age_of_parent = (uint8_t)value;
+	} else {
+		return rsunicast_set_parameter(name, value);
+	}
+	return 1;
+}
+
+/**
+ * Parses a line of the form 'NAME=VALUE' and sets the parameter.
+ * Returns 1 on success, 0 if the line is malformed or the name is unknown.
+ */
+uint8_t mlst_parse_parameter(const char* line)
+{
+	char name[40];
+	const char* eq = strchr(line, '=');
+	if(eq == 0 || eq == line || eq-line >= sizeof(name)) return 0;
+	memcpy(name, line, eq-line);
+	name[eq-line] = 0;
+	return mlst_set_parameter(name, atof(eq+1));
+}
+
+/**
+ * Prints all parameters in the 'NAME=VALUE' format (so the output can be fed back).
+ */
+void mlst_print_config()
+{
+	printf("CONFIG MAX_AGE_OF_MLST_NBR_IN_SECONDS=%u MLST_PERIOD_LENGTH_IN_SECONDS=%ld.%03ld IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS=%u MAX_AGE_OF_PARENT=%u\n",
+			mlst_config.max_age_of_nbr_in_seconds, (long)mlst_config.period_length_in_seconds,
+			(long)(mlst_config.period_length_in_seconds*1000)%1000, mlst_config.stay_active_for_n_periods, mlst_config.max_age_of_parent);
+}
+
+/**
+ * Listens on the serial port for parameter lines. Started by mlst_init().
+ */
+PROCESS(mlst_config_process, "MLST Config");
+PROCESS_THREAD(mlst_config_process, ev, data)
+{
+	PROCESS_BEGIN();
+	while(1) {
+		PROCESS_WAIT_EVENT_UNTIL(ev == serial_line_event_message && data != 0);
+		if(mlst_parse_parameter((const char*) data) == 0) {
+			printf("CONFIG ERROR: %s\n", (const char*) data);
+		} else {
+			mlst_print_config();
+		}
+	}
+	PROCESS_END();
+}
+#endif
+
+#endif
@@ -26,25 +26,35 @@
 #include "net/rime/rime.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include "lib/random.h"
 #include "./public_variable_neighborhood/public_variable_neighborhood.h"
 #include "leds.h"
 #include "./rsunicast/rsunicast.h"
-#include "./auxiliary.h"
+#include "./timing/timing.h"
+#include "./trace/trace.h"
+#include "./mlst_stats.h"
+#ifdef TOPOLOGY_REPORT
+#include "./topology/topology_report.h"
+#endif
 
 //The Port for the public variable system
 #define MLST_PVN_PORT 154
-//After this time without refreshment neighbor-entries are deleted
-#define MAX_AGE_OF_MLST_NBR_IN_SECONDS 15
-//The length of a period in the calculation. In each period a while-loop with the MLST Calculation is executed as well as the state broadcasted. It will be randomized a little.
-#define MLST_PERIOD_LENGTH_IN_SECONDS 1
-//If there has been a change, the node is not going to sleep even if it is a leaf for this amount of periods
-#define IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS 3
-//the maximal age of the parent neighbor entry in seconds. It will stay awake if it is too old until the entry is updated.
-#define MAX_AGE_OF_PARENT 5
+//The tuning parameters (MAX_AGE_OF_MLST_NBR_IN_SECONDS, MLST_PERIOD_LENGTH_IN_SECONDS, IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS,
+//MAX_AGE_OF_PARENT) are defined here. They can be overridden at compile time or, with MLST_RUNTIME_CONFIG, at runtime.
+#include "./mlst_config.h"
+#include "./beacon_slots/beacon_slots.h"
+#include "./rate_limit/rate_limit.h"
+#include "./load_aware/load_aware.h"
 
 //Do not change. Used internally
-#define WAIT_ONE_PERIOD etimer_set(&mlst_period_timer, MLST_PERIOD_LENGTH_IN_SECONDS*CLOCK_SECOND*getRandomFloat(0.8,1.0)/divide_period_time_by); PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&mlst_period_timer));
+#define WAIT_ONE_PERIOD etimer_set(&mlst_period_timer, BEACON_SLOTS_PERIOD(timing_between(MLST_PERIOD_TICKS - MLST_PERIOD_TICKS/5, MLST_PERIOD_TICKS)/divide_period_time_by, divide_period_time_by)); CPU_POWER_ANCHOR(etimer_expiration_time(&mlst_period_timer)); PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&mlst_period_timer));
+#define WAIT_FOR_SOLICITATION_ANSWERS etimer_set(&mlst_period_timer, PVN_SOLICIT_WINDOW); PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&mlst_period_timer));
+#ifdef PVN_SOLICITATION
+#define WAIT_FOR_PARENT_BEACON etimer_set(&mlst_period_timer, PVN_SOLICIT_WINDOW); PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&mlst_period_timer) || mlst_parent_heard);
+#else
+#define WAIT_FOR_PARENT_BEACON etimer_set(&mlst_period_timer, MLST_PERIOD_TICKS/divide_period_time_by); PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&mlst_period_timer) || mlst_parent_heard);
+#endif
 #define RIME_ID ((linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1])
 
 //**Variables**
@@ -53,6 +63,10 @@ uint8_t mlst_stay_active_for_next_n_periods = 0; //Stay active for some rounds e
 uint8_t divide_period_time_by = 1; //Used to shorten the period length during busy phases (for a quick convergence)
 struct PVN mlst_pvn; //The public variable neighborhood system
 struct etimer mlst_period_timer; //Timer used for the period delays
+#ifdef MLST_DIGEST
+uint8_t mlst_parent_digest = 0; //digest of the parent at the last recalculation
+uint8_t mlst_parent_heard = 0; //1 iff the parent has been heard since the leaf woke up
+#endif
 //--Variables--
 
 
@@ -69,6 +83,18 @@ struct mlst_public_variable{
 	uint16_t parent_id;
 	uint8_t children_count;
 	uint8_t energy_state;
+#ifdef MLST_DIGEST
+	uint8_t digest; //digest of the neighborhood (see mlst_recalculate), the fields behind it are not covered
+#endif
+#ifdef MLST_BEACON_SLOTS
+	uint8_t beacon_slot; //slot of the own beacons (see ./beacon_slots/beacon_slots.h)
+	uint16_t beacon_slots_used; //slots of the neighbors
+	uint16_t beacon_slots_conflicts; //slots that are used by more than one neighbor
+#endif
+#ifdef MLST_LOAD_AWARE
+	uint8_t forward_rate; //forwarded messages per minute (see ./load_aware/load_aware.h)
+	uint8_t queue_depth; //messages in the queue of rsunicast
+#endif
 };
 struct mlst_public_variable own_mlst_public_variable;//The own public variable
 
@@ -98,6 +124,8 @@ static void onPvnDelete(struct Nbr* n)
 #endif
 	mlst_stay_active_for_next_n_periods = IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS;
 	if(n == mlst_parent){ //If parent is deleted, reset state
+		TRACE_EVENT(TRACE_PARENT_CHANGE, 0, 0, own_mlst_public_variable.parent_id);
+		MLST_STATS_COUNT(parent_changes);
 		mlst_parent = 0;
 		own_mlst_public_variable.parent_id = 0;
 		own_mlst_public_variable.distance_to_root_high = 0xff;
@@ -116,7 +144,131 @@ static uint8_t pvnCmp(void* a, void* b)
 	return 0;
 }
 
+#ifdef RSUNICAST_ACK_PAYLOAD
+//called for ACKs with the public variable of the neighbor (the parent), which is as good as its beacon
+static void onAckPayload(uint16_t id, void* payload, uint8_t size)
+{
+	if(size == sizeof(struct mlst_public_variable)) pvn_refresh(&mlst_pvn, id, payload);
+}
+#endif
+
+#ifdef RSUNICAST_BEACON_ACK
+//the messages to the parent are acknowledged in its beacons as long as they are received
+static uint8_t mlst_can_hear_beacons()
+{
+	return pvn_is_online(&mlst_pvn);
+}
+
+//the acknowledgements for the children are sent in an expedited beacon
+static void mlst_request_beacon()
+{
+	pvn_expedite(&mlst_pvn, RSU_BEACON_ACK_DELAY);
+}
+
+#endif
+
+#if defined(RSUNICAST_OPPORTUNISTIC) || defined(RSUNICAST_MULTIPATH)
+//the distance to the root of a public variable (smaller is closer)
+static uint16_t mlst_distance_of(struct mlst_public_variable* pv)
+{
+	//the distance of the best energy class in which the node is defined
+	return pv->distance_to_root_high != 0xff ? pv->distance_to_root_high :
+			(pv->distance_to_root_middle != 0xff ? pv->distance_to_root_middle : pv->distance_to_root_low);
+}
+
+//the candidates for opportunistic forwarding and redundant copies: the parent, then the other backbone neighbors that are closer to the root
+//(sorted by the distance). Leaves are not used, they would have to stay awake to forward.
+static uint8_t mlst_candidates(uint16_t* ids, uint8_t max)
+{
+	uint16_t distances[RSU_MAX_CANDIDATES];
+	uint16_t own_distance = mlst_distance_of(&own_mlst_public_variable);
+	uint8_t n = 0, i;
+	if(mlst_parent == 0 || own_mlst_public_variable.parent_id == 0 || max == 0) return 0;
+	if(max > RSU_MAX_CANDIDATES) max = RSU_MAX_CANDIDATES;
+	ids[n++] = mlst_parent->id;
+	struct Nbr* nbr = pvn_getNbrs(&mlst_pvn);
+	for(; nbr!=0; nbr=pvn_getNextNbr(nbr)){
+		struct mlst_public_variable* pv = (struct mlst_public_variable*)(nbr->public_var);
+		uint16_t distance = mlst_distance_of(pv);
+		if(nbr == mlst_parent || pv->parent_id == 0 || pv->parent_id == RIME_ID || pv->children_count == 0 ||
+				distance >= own_distance) continue;
+		//insert behind the parent, the farthest candidate is dropped if the list is full
+		for(i=n; i>1 && distances[i-1] > distance; i--){
+			if(i < max){ ids[i] = ids[i-1]; distances[i] = distances[i-1]; }
+		}
+		if(i < max){
+			ids[i] = nbr->id;
+			distances[i] = distance;
+			if(n < max) n++;
+		}
+	}
+	return n;
+}
+#endif
+
+#if defined(MLST_CONVERGECAST) || defined(MLST_BEACON_SLOTS) || defined(MLST_RATE_LIMIT) || defined(RSUNICAST_BEACON_ACK)
+//writes the appendix of the own beacons: the phases of the convergecast cycle and of the beacon frame, the admitted
+//rate, then the acknowledgements for the children
+static uint8_t mlst_write_appendix(uint8_t* buf, uint8_t max)
+{
+	uint8_t len = 0;
+#ifdef MLST_CONVERGECAST
+	buf[len++] = convergecast_phase();
+#endif
+#ifdef MLST_BEACON_SLOTS
+	buf[len++] = beacon_slots_phase();
+#endif
+#ifdef MLST_RATE_LIMIT
+	buf[len++] = rate_limit_rate();
+#endif
+#ifdef RSUNICAST_BEACON_ACK
+	len += rsunicast_write_beacon_acks(buf + len, max - len);
+#endif
+	return len;
+}
+
+//reads the appendix of a received beacon
+static void mlst_read_appendix(struct Nbr* n, uint8_t* appendix, uint8_t len)
+{
+#ifdef MLST_CONVERGECAST
+	//the cycle is defined by the root and passed down the tree
+	if(n->id == own_mlst_public_variable.parent_id) convergecast_sync(appendix[0]);
+	appendix++;
+	len--;
+#endif
+#ifdef MLST_BEACON_SLOTS
+	if(len == 0) return;
+	if(n->id == own_mlst_public_variable.parent_id) beacon_slots_sync(appendix[0]);
+	appendix++;
+	len--;
+#endif
+#ifdef MLST_RATE_LIMIT
+	if(len == 0) return;
+	if(n->id == own_mlst_public_variable.parent_id) rate_limit_sync(appendix[0]);
+	appendix++;
+	len--;
+#endif
+#ifdef RSUNICAST_BEACON_ACK
+	rsunicast_on_beacon(n->id, appendix, len);
+#endif
+}
+#endif
+
+#ifdef MLST_DIGEST
+PROCESS_NAME(mlst_process);
+//called for every received public variable, wakes up a leaf that waits for the beacon of its parent
+static void onPvnUpdate(struct Nbr* n)
+{
+	if(n == mlst_parent){
+		mlst_parent_heard = 1;
+		process_poll(&mlst_process);
+	}
+}
+
+struct PVN_callbacks mlst_pvn_callbacks = {onPvnChange, onPvnNew, onPvnDelete, onPvnUpdate}; //The callbacks for the public variable neighborhood. Called on specific changes
+#else
 struct PVN_callbacks mlst_pvn_callbacks = {onPvnChange, onPvnNew, onPvnDelete}; //The callbacks for the public variable neighborhood. Called on specific changes
+#endif
 //--Public Variable-----------------------------------------------------------------------
 
 /** 
@@ -133,13 +285,56 @@ void eamlst_set_energy_state(uint8_t s)
 	own_mlst_public_variable.energy_state = s;
 }
 
+//Return values of mlst_send
+#define MLST_DEFERRED 0
+#define MLST_ACCEPTED 1
+
 /**
  * Sends a message to the sink of the MLST using multiple hops. Can also be used if the parent is not determined yet.
- * The message is copied and put into a message queue.
+ * The message is copied and put into a message queue. Returns MLST_ACCEPTED, or MLST_DEFERRED if the message has not
+ * been taken (MLST_RATE_LIMIT: the node has exceeded its rate, RSUNICAST_FAIR_QUEUE: too many own messages are waiting).
+ * A deferred message can be sent later, or merged with the next reading.
+ */
+uint8_t mlst_send(void *msg, uint16_t size){
+	if(RATE_LIMIT_ADMIT() == 0) return MLST_DEFERRED;
+	if(rsunicast_send(msg, size) == 0){
+		RATE_LIMIT_REFUND();
+		return MLST_DEFERRED;
+	}
+	return MLST_ACCEPTED;
+}
+
+#ifdef MLST_RATE_LIMIT
+/**
+ * Returns the rate in messages per minute that is currently admitted for this node (see ./rate_limit/rate_limit.h).
+ * The application can adapt its sampling interval to it.
+ */
+uint8_t mlst_rate(){
+	return rate_limit_rate();
+}
+#endif
+
+#ifdef RSUNICAST_MULTIPATH
+/**
+ * Sends copies of a critical message (e.g. an alarm) over up to copies different first hops (the parent and other
+ * backbone neighbors that are closer to the root), so it survives the failure of one of them. The root passes only the
+ * first copy to the callback. Returns the number of queued copies (0 if the message has not been taken).
+ */
+uint8_t mlst_send_redundant(void *msg, uint16_t size, uint8_t copies){
+	return rsunicast_send_redundant(msg, size, copies);
+}
+#endif
+
+#ifdef RSUNICAST_BEACON_ACK
+/**
+ * Like mlst_send, but every hop acknowledges the message immediately instead of in its next beacon (e.g. for alarms).
+ * Not limited by MLST_RATE_LIMIT. Returns MLST_ACCEPTED, or MLST_DEFERRED if the message has not been taken
+ * (RSUNICAST_FAIR_QUEUE: too many own messages are waiting).
  */
-void mlst_send(void *msg, uint16_t size){
-	rsunicast_send(msg, size);
+uint8_t mlst_send_urgent(void *msg, uint16_t size){
+	return rsunicast_send_urgent(msg, size) != 0 ? MLST_ACCEPTED : MLST_DEFERRED;
 }
+#endif
 
 /**
  * Returns 1 iff the parent is not determined yet
@@ -150,12 +345,14 @@ uint8_t mlst_is_undefined(){
 
 //is called when the node is not allowed to sleep
 static void mlst_online(){
+	if(pvn_is_online(&mlst_pvn)==0) TRACE_EVENT(TRACE_WAKE, 0, 0, 0);
 	pvn_set_online(&mlst_pvn);
 	leds_off(LEDS_GREEN);
 }
 
 //is called when the node is allowed to sleep
 static void mlst_offline(){
+	if(pvn_is_online(&mlst_pvn)!=0) TRACE_EVENT(TRACE_SLEEP, 0, 0, 0);
 	pvn_set_offline(&mlst_pvn);
 	leds_on(LEDS_GREEN);
 }
@@ -168,11 +365,87 @@ static uint8_t mlst_is_leaf(){
 	return own_mlst_public_variable.children_count==0;
 }
 
+#ifdef PVN_ANNOUNCED_VALIDITY
+//A leaf whose public variable has not changed only sends every MLST_LEAF_BEACON_EVERY-th beacon. It announces
+//the longer interval, thus its neighbors (e.g. the parent that counts it as child) keep its entry in between.
+#ifndef MLST_LEAF_BEACON_EVERY
+#define MLST_LEAF_BEACON_EVERY 8
+#endif
+
+//**LEAF BEACONS**
+uint8_t mlst_beacons_to_skip = 0; //beacons that may still be skipped within the announced interval
+struct mlst_public_variable mlst_last_beacon; //the own public variable in the last sent beacon
+//--LEAF BEACONS--
+
+//Returns an upper bound of the time in seconds until the beacon after the given number of periods
+static uint8_t mlst_beacon_interval(uint8_t periods)
+{
+	clock_time_t period = MLST_PERIOD_TICKS/divide_period_time_by;
+#ifdef MLST_BEACON_SLOTS
+	//the own slot in the next frame is up to one and a half frames away
+	if(divide_period_time_by == 1 && period < BEACON_SLOTS_FRAME + BEACON_SLOTS_FRAME/2) period = BEACON_SLOTS_FRAME + BEACON_SLOTS_FRAME/2;
+#endif
+#if defined(PVN_SOLICITATION) || defined(MLST_DIGEST)
+	period += MLST_PERIOD_TICKS; //a waking leaf can wait for its parent before the period
+#endif
+	unsigned long seconds = ((unsigned long) period*periods + CLOCK_SECOND - 1)/CLOCK_SECOND;
+	return seconds < 0xff ? seconds : 0xff;
+}
+
+//Sends the own beacon, unless this node is a leaf that may sleep, its public variable is unchanged and its last beacon
+//has announced a longer interval (also in the periods in which it only listens for its parent)
+static void mlst_beacon(){
+	uint8_t quiet = mlst_is_leaf() && mlst_stay_active_for_next_n_periods == 0;
+	if(quiet && mlst_beacons_to_skip > 0 &&
+			memcmp(&mlst_last_beacon, &own_mlst_public_variable, sizeof(struct mlst_public_variable)) == 0){
+		mlst_beacons_to_skip--;
+		return;
+	}
+	mlst_beacons_to_skip = quiet ? MLST_LEAF_BEACON_EVERY - 1 : 0;
+	pvn_set_announced_interval(&mlst_pvn, mlst_beacon_interval(mlst_beacons_to_skip + 1));
+	memcpy(&mlst_last_beacon, &own_mlst_public_variable, sizeof(struct mlst_public_variable));
+	pvn_broadcast(&mlst_pvn);
+}
+#define MLST_BEACON() mlst_beacon()
+#else
+#define MLST_BEACON() pvn_broadcast(&mlst_pvn)
+#endif
+
 
 //*****************************************************************
 // MLST Calculation
 //*****************************************************************
 
+#if defined(MLST_LOAD_AWARE) && !defined(ROOT)
+//the children of a potential parent without this node, at least (it may be counted by the current and the last parent,
+//see ./load_aware/load_aware.h)
+static uint8_t mlst_other_children(struct Nbr* n, struct mlst_public_variable* pv)
+{
+	if(pv->children_count > 0 && load_aware_counts_me(n->id, own_mlst_public_variable.parent_id)) return pv->children_count-1;
+	return pv->children_count;
+}
+
+//the load of a potential parent without the traffic of this node (which is included if it is the current parent)
+static uint16_t mlst_load_of(struct Nbr* n, struct mlst_public_variable* pv)
+{
+	uint16_t load = load_aware_load(pv->forward_rate, pv->queue_depth);
+	if(n->id != own_mlst_public_variable.parent_id) return load;
+	return load > load_aware_own_rate() ? load - load_aware_own_rate() : 0;
+}
+
+//1 iff the potential parent a is preferred to b (same distance) because it is clearly less loaded. a is not preferred if it
+//would become backbone only because of this node while b stays backbone, thus the number of leaves is not reduced
+//(see ./load_aware/load_aware.h)
+static uint8_t mlst_load_prefers(struct Nbr* a, struct mlst_public_variable* a_pv, struct Nbr* b, struct mlst_public_variable* b_pv)
+{
+	if(mlst_other_children(a, a_pv) == 0 && b_pv->children_count > (b->id == own_mlst_public_variable.parent_id ? 1 : 0)) return 0;
+	return load_aware_prefers(mlst_load_of(a, a_pv), a_pv->children_count, mlst_load_of(b, b_pv), b_pv->children_count);
+}
+#define MLST_LOAD_PREFERS(a, a_pv, b, b_pv) mlst_load_prefers(a, a_pv, b, b_pv)
+#else
+#define MLST_LOAD_PREFERS(a, a_pv, b, b_pv) 0
+#endif
+
 //Here is a feedback loop round of the MLST algorithm
 static void mlst_recalculate(){
 #ifdef ROOT
@@ -182,6 +455,7 @@ static void mlst_recalculate(){
 	own_mlst_public_variable.parent_id = 0xffff;
 	own_mlst_public_variable.children_count = 0xff;
 #else 
+	uint16_t old_parent_id = own_mlst_public_variable.parent_id;
 	uint8_t children_count = 0;
 	uint8_t distance_to_root_high = 0xff;
 	uint8_t distance_to_root_middle = 0xff;
@@ -204,11 +478,18 @@ static void mlst_recalculate(){
 				children_count++;
 				continue;
 			} else { //potential parent
-				if( (n_pv-> energy_state == 1 && n_pv->distance_to_root_high!=0xff && n_pv->distance_to_root_high+1 == distance_to_root_high) ||
+				if( best_parent_pv!=0 && (
+						(n_pv-> energy_state == 1 && n_pv->distance_to_root_high!=0xff && n_pv->distance_to_root_high+1 == distance_to_root_high) ||
 						(distance_to_root_high == 0xff && n_pv-> energy_state != 3 && n_pv->distance_to_root_middle!= 0xff && n_pv->distance_to_root_middle+1 == distance_to_root_middle) ||
-						(distance_to_root_high == 0xff && distance_to_root_middle == 0xff && n_pv->distance_to_root_low!= 0xff && n_pv->distance_to_root_low+1 == distance_to_root_low) )
+						(distance_to_root_high == 0xff && distance_to_root_middle == 0xff && n_pv->distance_to_root_low!= 0xff && n_pv->distance_to_root_low+1 == distance_to_root_low) ) )
 				{
-					if(best_parent_pv->children_count < n_pv->children_count){//more children than current best parent
+					if(MLST_LOAD_PREFERS(n, n_pv, best_parent, best_parent_pv)){//(nearly) as many children, but clearly less loaded
+						number_of_potential_parents = 1;
+						best_parent = n;
+						best_parent_pv = n_pv;
+					} else if(MLST_LOAD_PREFERS(best_parent, best_parent_pv, n, n_pv)){
+						//the current best parent is clearly less loaded, it is kept
+					} else if(best_parent_pv->children_count < n_pv->children_count){//more children than current best parent
 						number_of_potential_parents = 1;
 						best_parent = n;
 						best_parent_pv = n_pv;
@@ -252,11 +533,13 @@ static void mlst_recalculate(){
 	//set state
 	if(best_parent!=0){
 		//if parent is not unique, you may want to wait one round
-		if(number_of_potential_parents>1 && random_rand()<0.5*RANDOM_RAND_MAX){
+		if(number_of_potential_parents>1 && (timing_rand() & 1)){
 			//stay undefined
 #ifdef DEBUG
 			printf("CANNOT DECIDE\n");
 #endif
+			TRACE_EVENT(TRACE_CANNOT_DECIDE, number_of_potential_parents, 0, 0);
+			MLST_STATS_COUNT(cannot_decide);
 			own_mlst_public_variable.parent_id = 0;
 			own_mlst_public_variable.distance_to_root_high = 0xff;
 			own_mlst_public_variable.distance_to_root_middle = 0xff;
@@ -292,6 +575,32 @@ static void mlst_recalculate(){
 		own_mlst_public_variable.children_count = children_count;
 	}
 
+	if(old_parent_id != own_mlst_public_variable.parent_id){
+		TRACE_EVENT(TRACE_PARENT_CHANGE, own_mlst_public_variable.children_count, own_mlst_public_variable.parent_id, old_parent_id);
+		MLST_STATS_COUNT(parent_changes);
+#ifdef MLST_LOAD_AWARE
+		load_aware_parent_changed(old_parent_id);
+#endif
+	}
+#endif
+#ifdef MLST_BEACON_SLOTS
+	//the slots of the neighbors and their neighbors, moves the own slot if it is in conflict
+	beacon_slots_begin(RIME_ID);
+	struct Nbr* slot_nbr = pvn_getNbrs(&mlst_pvn);
+	for(; slot_nbr!=0; slot_nbr=pvn_getNextNbr(slot_nbr)){
+		struct mlst_public_variable* slot_pv = (struct mlst_public_variable*)(slot_nbr->public_var);
+		beacon_slots_neighbor(slot_nbr->id, slot_pv->beacon_slot, slot_pv->beacon_slots_used, slot_pv->beacon_slots_conflicts);
+	}
+	beacon_slots_end();
+	own_mlst_public_variable.beacon_slot = beacon_slots_own();
+	own_mlst_public_variable.beacon_slots_used = beacon_slots_used();
+	own_mlst_public_variable.beacon_slots_conflicts = beacon_slots_conflicts();
+#endif
+#ifdef MLST_DIGEST
+	//the digest covers the own state and the neighborhood, but not the digests of the neighbors (otherwise every change
+	//would spread through the whole network)
+	own_mlst_public_variable.digest = pvn_digest(&mlst_pvn, offsetof(struct mlst_public_variable, digest));
+	if(mlst_parent != 0) mlst_parent_digest = ((struct mlst_public_variable*) mlst_parent->public_var)->digest;
 #endif
 }
 
@@ -330,9 +639,36 @@ PROCESS_THREAD(mlst_process, ev, data)
 
 			if(mlst_is_leaf()>0){
 				rsunicast_allowSleeping();
+#if defined(PVN_SOLICITATION) || defined(MLST_DIGEST)
+				if(mlst_stay_active_for_next_n_periods==0 && clock_seconds()-mlst_parent->timestamp > MAX_AGE_OF_PARENT){
+					//only the information of the parent is outdated: ask the neighbors (PVN_SOLICITATION) or wait for the
+					//beacon of the parent (MLST_DIGEST) instead of listening for a whole period.
+					//If the parent answers and nothing has changed, the leaf goes back to sleep below.
+					mlst_online();
+#ifdef PVN_SOLICITATION
+					pvn_solicit(&mlst_pvn);
+#endif
+#ifdef MLST_DIGEST
+					mlst_parent_heard = 0;
+					WAIT_FOR_PARENT_BEACON;
+					if(mlst_parent_heard != 0 && rsu_messages_in_queue == 0 &&
+							((struct mlst_public_variable*) mlst_parent->public_var)->digest == mlst_parent_digest){
+						//the neighborhood of the parent is unchanged: no recalculation, sleep again immediately
+						TRACE_EVENT(TRACE_DIGEST_SLEEP, mlst_parent_digest, mlst_parent->id, 0);
+					} else {
+						mlst_recalculate();
+					}
+#else
+					WAIT_FOR_SOLICITATION_ANSWERS;
+					mlst_recalculate();
+#endif
+					if(mlst_is_leaf()==0 && mlst_stay_active_for_next_n_periods==0) mlst_stay_active_for_next_n_periods = 1; //no longer a defined leaf
+				}
+#endif
 				//is allowed to sleep
 				if(mlst_stay_active_for_next_n_periods>0 || clock_seconds()-mlst_parent->timestamp > MAX_AGE_OF_PARENT){
 					//stay awake to fetch some news before sleeping again
+					if(mlst_stay_active_for_next_n_periods>0) MLST_STATS_COUNT(stay_active_periods);
 					mlst_online();
 					WAIT_ONE_PERIOD;
 					mlst_recalculate();
@@ -350,11 +686,27 @@ PROCESS_THREAD(mlst_process, ev, data)
 				mlst_recalculate();
 			}
 		}
+		MLST_STATS_PERIOD(pvn_is_online(&mlst_pvn), own_mlst_public_variable.parent_id);
+		RATE_LIMIT_UPDATE(rsu_messages_in_queue);
+#ifdef MLST_LOAD_AWARE
+		load_aware_update(rsu_messages_enqueued, rsu_messages_forwarded, rsu_messages_in_queue);
+		own_mlst_public_variable.forward_rate = load_aware_forward_rate();
+		own_mlst_public_variable.queue_depth = load_aware_queue_depth();
+#endif
 
 		//set parent in messaging
 		rsunicast_setparent(own_mlst_public_variable.parent_id);
+#ifdef MLST_CONVERGECAST
+		//the parent is chosen in the best class, thus its distance is the depth in the tree
+		convergecast_set_depth(own_mlst_public_variable.distance_to_root_high != 0xff ? own_mlst_public_variable.distance_to_root_high :
+				(own_mlst_public_variable.distance_to_root_middle != 0xff ? own_mlst_public_variable.distance_to_root_middle :
+				own_mlst_public_variable.distance_to_root_low));
+#endif
+#ifdef TOPOLOGY_REPORT
+		topology_report_update(own_mlst_public_variable.parent_id, own_mlst_public_variable.children_count, own_mlst_public_variable.energy_state, mlst_parent);
+#endif
 
-		pvn_broadcast(&mlst_pvn);
+		MLST_BEACON();
 		if(mlst_stay_active_for_next_n_periods>0){ 
 			mlst_stay_active_for_next_n_periods--;
 		}
@@ -383,7 +735,50 @@ void mlst_init(){
 		pvn_set_comparison_function(&mlst_pvn, pvnCmp);
 		pvn_setCallbacks(&mlst_pvn, mlst_pvn_callbacks);
 		is_initialized = 1;
+#ifdef MLST_TRACE
+		trace_init();
+#endif
+		MLST_STATS_INIT();
+#ifdef RADIO_POWER_MANAGER
+		radio_power_init();
+#endif
+#ifdef CPU_POWER_MANAGER
+		cpu_power_init();
+#endif
+#ifdef MLST_RECORD
+		record_init();
+#endif
 		rsunicast_init();
+#ifdef RSUNICAST_ACK_PAYLOAD
+		//every ACK proves that the parent is alive and carries its current state
+		rsunicast_setAckPayload(&own_mlst_public_variable, sizeof(struct mlst_public_variable));
+		rsunicast_setAckPayloadCallback(onAckPayload);
+#endif
+#ifdef RSUNICAST_BEACON_ACK
+		rsunicast_setBeaconAckCallbacks(mlst_can_hear_beacons, mlst_request_beacon);
+#endif
+#if defined(RSUNICAST_OPPORTUNISTIC) || defined(RSUNICAST_MULTIPATH)
+		rsunicast_setCandidatesCallback(mlst_candidates);
+#endif
+#ifdef MLST_CONVERGECAST
+		convergecast_init();
+#endif
+#ifdef MLST_BEACON_SLOTS
+		beacon_slots_init(RIME_ID);
+		own_mlst_public_variable.beacon_slot = beacon_slots_own();
+#endif
+#ifdef MLST_RATE_LIMIT
+		rate_limit_init();
+#endif
+#if defined(MLST_CONVERGECAST) || defined(MLST_BEACON_SLOTS) || defined(MLST_RATE_LIMIT) || defined(RSUNICAST_BEACON_ACK)
+		pvn_set_appendix(&mlst_pvn, mlst_write_appendix, mlst_read_appendix);
+#endif
+#ifdef TOPOLOGY_REPORT
+		topology_report_init();
+#endif
+#ifdef MLST_RUNTIME_CONFIG
+		process_start(&mlst_config_process, 0);
+#endif
 
 		//start process
 		process_start(&mlst_process,0);
@@ -397,6 +792,30 @@ void mlst_init(){
 void mlst_print_state(){
 	printf("MLST[Parent:%d, #Children:%d]\n", own_mlst_public_variable.parent_id, own_mlst_public_variable.children_count);
 	pvn_print_state(&mlst_pvn);
+#ifdef RADIO_ENERGY_ACCOUNTING
+	radio_energy_print_state();
+#endif
+#ifdef RADIO_POWER_MANAGER
+	radio_power_print_state();
+#endif
+#ifdef CPU_POWER_MANAGER
+	cpu_power_print_state();
+#endif
+#ifdef MLST_CONVERGECAST
+	convergecast_print_state();
+#endif
+#ifdef MLST_BEACON_SLOTS
+	beacon_slots_print_state();
+#endif
+#ifdef MLST_RATE_LIMIT
+	rate_limit_print_state();
+#endif
+#ifdef MLST_LOAD_AWARE
+	load_aware_print_state();
+#endif
+#ifdef MLST_STATS
+	mlst_stats_print();
+#endif
 }
 
 
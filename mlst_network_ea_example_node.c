@@ -25,7 +25,7 @@
 #include "mlst_network-ea3.h"
 #endif
 
-#include "./auxiliary.h"
+#include "./timing/timing.h"
 
 
 /*---------------------------------------------------------------------------*/
@@ -47,7 +47,7 @@ PROCESS_THREAD(example_mlst_node_process, ev, data)
 	while(1) {
 		mlst_print_state();
 		rsunicast_print_state();
-		etimer_set(&et, CLOCK_SECOND * 4 * getRandomFloat(0.5,1.0));
+		etimer_set(&et, timing_between(CLOCK_SECOND * 2, CLOCK_SECOND * 4));
 		//uint8_t data[7];
 		//mlst_send(&data, sizeof(data));
 		PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
@@ -13,7 +13,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "mlst_network.h"
-#include "./auxiliary.h"
+#include "./timing/timing.h"
 
 
 /*---------------------------------------------------------------------------*/
@@ -33,9 +33,13 @@ PROCESS_THREAD(example_mlst_node_process, ev, data)
 
 	while(1) {
 		mlst_print_state();
-		etimer_set(&et, CLOCK_SECOND * 4 * getRandomFloat(0.5,1.0));
+		etimer_set(&et, CPU_POWER_COALESCE(timing_between(CLOCK_SECOND * 2, CLOCK_SECOND * 4))); //shares the wake-up of the MLST if close to it
 		uint8_t data[7];
-		mlst_send(&data, sizeof(data));
+		if(mlst_send(&data, sizeof(data)) == MLST_ACCEPTED){
+			printf("Sent Message\n");
+		} else {
+			printf("Deferred Message\n"); //not counted as sent (MLST_RATE_LIMIT, RSUNICAST_FAIR_QUEUE)
+		}
 		PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
 	}
 
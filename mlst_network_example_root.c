@@ -17,9 +17,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "mlst_network.h"
+#ifdef SINK_SERIAL
+#include "./sink/sink_serial.h"
+#endif
 
 void onIncomingMessage(void* msg, uint16_t msg_size){
-	printf("Received Message\n");
+#ifdef SINK_SERIAL
+	//Stream the message with its origin to the host (./tools/sink_daemon.py)
+	sink_serial_on_message(msg, msg_size);
+#else
+	printf("Received Message from %u\n", rsunicast_message_origin());
+#endif
 }
 
 /*---------------------------------------------------------------------------*/
@@ -36,12 +44,19 @@ PROCESS_THREAD(example_mlst_root_process, ev, data)
 
 	//Initialize the mlst-network. Has to be done to open ports, etc.
 	mlst_init();	
+#ifdef SINK_SERIAL
+	sink_serial_init();
+#endif
 	//Sets the callback, that is called if a new message arrives
 	rsunicast_setNewMessageCallback_root(onIncomingMessage);
 
 	while(1) {
 		etimer_set(&et, CLOCK_SECOND * 4);
 		PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+#ifdef TOPOLOGY_REPORT
+		//Print the current tree for dashboards
+		topology_print_snapshot();
+#endif
 	}
 
 	PROCESS_END();
@@ -0,0 +1,125 @@
+/**
+ * MODULE OF mlst_network.h (and the EA variants)
+ *
+ * Convergence and stability instrumentation of the MLST process: the time until the node got its first parent, the number
+ * of parent changes, awake and asleep periods (and how many of the awake periods of a leaf are caused by
+ * IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS), the number of "cannot decide" rounds and the longest stable streak (consecutive
+ * periods with the same defined parent).
+ *
+ * The instrumentation is only compiled in if `MLST_STATS` is defined. Otherwise all hooks are empty.
+ * With MLST_TRACE, the first parent and the end of every stable streak are also emitted into the trace (./trace/trace.h).
+ *
+ * User Functions:
+ * ---------------------------
+ * void mlst_stats_get(struct mlst_stats* s); //Copies the current values
+ * void mlst_stats_reset(); //Sets all values to zero (time to first parent and the current streak are kept)
+ * void mlst_stats_print(); //Prints the current values
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef MLST_STATS_H
+#define MLST_STATS_H
+
+#include "contiki.h"
+#include <stdio.h>
+#include <string.h>
+#include "./trace/trace.h"
+
+#ifdef MLST_STATS
+
+#define MLST_STATS_UNDEFINED 0xffff
+
+struct mlst_stats {
+	uint16_t time_to_first_parent; //seconds from mlst_init until the first parent, MLST_STATS_UNDEFINED if not yet defined
+	uint16_t parent_changes; //includes the first parent and the loss of the parent
+	uint16_t awake_periods;
+	uint16_t asleep_periods;
+	uint16_t stay_active_periods; //awake periods of a leaf caused by IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS
+	uint16_t cannot_decide; //rounds in which the parent was ambiguous and stayed undefined
+	uint16_t current_streak; //periods with the current parent
+	uint16_t longest_streak;
+};
+
+//**VARIABLES**
+struct mlst_stats mlst_stats;
+unsigned long mlst_stats_start = 0; //clock_seconds() of mlst_init
+uint16_t mlst_stats_streak_parent = 0; //parent of the current streak
+//--VARIABLES--
+
+/**
+ * Called by mlst_init().
+ */
+void mlst_stats_init()
+{
+	memset(&mlst_stats, 0, sizeof(struct mlst_stats));
+	mlst_stats.time_to_first_parent = MLST_STATS_UNDEFINED;
+	mlst_stats_start = clock_seconds();
+}
+
+/**
+ * Called at the end of each period of the MLST process with the online state during the period and the current parent.
+ */
+void mlst_stats_period(uint8_t online, uint16_t parent)
+{
+	if(online) mlst_stats.awake_periods++;
+	else mlst_stats.asleep_periods++;
+
+	if(parent != 0 && mlst_stats.time_to_first_parent == MLST_STATS_UNDEFINED) {
+		mlst_stats.time_to_first_parent = clock_seconds()-mlst_stats_start;
+		TRACE_EVENT(TRACE_FIRST_PARENT, 0, parent, mlst_stats.time_to_first_parent);
+	}
+
+	if(parent != 0 && parent == mlst_stats_streak_parent) {
+		mlst_stats.current_streak++;
+	} else {
+		if(mlst_stats.current_streak > 0) TRACE_EVENT(TRACE_STREAK_END, 0, mlst_stats_streak_parent, mlst_stats.current_streak);
+		mlst_stats.current_streak = parent != 0 ? 1 : 0;
+		mlst_stats_streak_parent = parent;
+	}
+	if(mlst_stats.current_streak > mlst_stats.longest_streak) mlst_stats.longest_streak = mlst_stats.current_streak;
+}
+
+/**
+ * Copies the current values.
+ */
+void mlst_stats_get(struct mlst_stats* s)
+{
+	memcpy(s, &mlst_stats, sizeof(struct mlst_stats));
+}
+
+/**
+ * Sets all values to zero. The time to first parent and the current streak are kept.
+ */
+void mlst_stats_reset()
+{
+	uint16_t time_to_first_parent = mlst_stats.time_to_first_parent;
+	uint16_t current_streak = mlst_stats.current_streak;
+	memset(&mlst_stats, 0, sizeof(struct mlst_stats));
+	mlst_stats.time_to_first_parent = time_to_first_parent;
+	mlst_stats.current_streak = current_streak;
+	mlst_stats.longest_streak = current_streak;
+}
+
+/**
+ * Prints the current values to the serial port.
+ */
+void mlst_stats_print()
+{
+	printf("MLST_STATS[first_parent=%us, parent_changes=%u, awake=%u, asleep=%u, stay_active=%u, cannot_decide=%u, streak=%u, longest_streak=%u]\n",
+			mlst_stats.time_to_first_parent, mlst_stats.parent_changes, mlst_stats.awake_periods, mlst_stats.asleep_periods,
+			mlst_stats.stay_active_periods, mlst_stats.cannot_decide, mlst_stats.current_streak, mlst_stats.longest_streak);
+}
+
+#define MLST_STATS_INIT() mlst_stats_init()
+#define MLST_STATS_PERIOD(online, parent) mlst_stats_period(online, parent)
+#define MLST_STATS_COUNT(field) mlst_stats.field++
+#else
+#define MLST_STATS_INIT()
+#define MLST_STATS_PERIOD(online, parent)
+#define MLST_STATS_COUNT(field)
+#endif
+
+#endif
@@ -16,10 +16,45 @@
  * ---------------------------
  *  void pvn_setCallbacks(struct PVN* pvn, struct PVN_callbacks callbacks); //Sets callbacks for 'new neighbor'/'neighbor removed'/'neighbor changed' events
  *  void pvn_set_comparison_function(struct PVN* pvn, uint8_t (*cmp)(void*, void*)); //Sets an optimal comparison function to check if neighbor has changed
+ *  void pvn_set_max_age(struct PVN* pvn, uint8_t maxAge); //Changes the maximum age of neighbor entries
  *  struct Nbr* pvn_getNbrs(struct PVN* pvn); //Returns first neighbor
  *  struct Nbr* pvn_getNextNbr(struct Nbr* n); //Returns next neighbor or 0
  * 	uint16_t pvn_neighborhood_size(struct PVN* pvn); //Returns size of neighborhood
  * 	void pvn_print_state(struct PVN* pvn); //Prints some info about the PVN (Neighbors, etc.)
+ *  uint8_t pvn_digest(struct PVN* pvn, uint8_t size); //Returns a digest of the own and the neighbors' public variables (first size bytes)
+ *  uint8_t pvn_refresh(struct PVN* pvn, uint16_t id, void* variable); //Updates a neighbor with a public variable that has been received by other means
+ *  void pvn_set_announced_interval(struct PVN* pvn, uint8_t seconds); //Sets the time until the next own beacon (only with PVN_ANNOUNCED_VALIDITY)
+ *  void pvn_solicit(struct PVN* pvn); //Asks the neighbors to broadcast their public variables now (only with PVN_SOLICITATION)
+ *  clock_time_t pvn_expedite(struct PVN* pvn, clock_time_t max_delay); //Broadcasts the public variable within a random delay
+ *  void pvn_set_appendix(struct PVN* pvn, uint8_t (*write)(uint8_t*, uint8_t), void (*read)(struct Nbr*, uint8_t*, uint8_t)); //Sets
+ *  					functions that append data of other modules to the beacons (e.g. acknowledgements, see ../rsunicast/rsunicast_beacon_ack.h)
+ *
+ * Announced Validity
+ * ---------------------------
+ * Without further information, a neighbor entry is outdated after the maximum age (see pvn_init), independent of how
+ * often the neighbor sends its beacons. With `#define PVN_ANNOUNCED_VALIDITY`, every beacon starts with one byte that
+ * announces the time in seconds until the next beacon of the sender (pvn_set_announced_interval). The entry is then
+ * kept for PVN_MISSED_BEACONS of these intervals, so neighbors that sleep longer than the maximum age are not deleted.
+ * The maximum age remains the minimum, thus nothing changes for neighbors that send their beacons often.
+ * All nodes have to use the same setting, as the frames of the two variants are not compatible.
+ *
+ * Solicitation
+ * ---------------------------
+ * With `#define PVN_SOLICITATION`, a node that has just woken up does not have to listen for a whole period to hear the
+ * beacons of its neighbors. It broadcasts an empty frame on the port of the PVN (public variables are never empty) and
+ * every online neighbor answers with its public variable after a random delay of at most PVN_SOLICIT_MAX_DELAY ticks.
+ * Several solicitations within this delay are answered by a single broadcast. The answers are received like normal
+ * beacons, thus after PVN_SOLICIT_WINDOW the neighborhood is up to date. The delay is spread over 16 ticks (at 128 Hz), a
+ * shorter one lets the answers of a dense neighborhood collide and the node has to listen for the whole period again.
+ * The delays assume a MAC without long wake-up strobes (e.g. nullrdc or a short ContikiMAC cycle), otherwise increase
+ * both by one cycle.
+ *
+ * Appendix
+ * ---------------------------
+ * Other modules can piggyback data on the beacons (pvn_set_appendix). The write function gets the free space behind the
+ * public variable and returns the number of bytes it has written, the read function gets the appendix of every received
+ * beacon that has one (before the callbacks of the neighborhood are called). Beacons with an appendix are only accepted
+ * if a read function is set.
  *
  *
  * @author Dominik Krupke, d.krupke@tu-bs.de
@@ -35,6 +70,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "sys/ctimer.h"
+#include "../timing/timing.h"
+#include "../radio_energy/radio_energy.h"
+#include "../radio_power/radio_power.h"
+#include "../trace/trace.h"
+#include "../trace/record.h"
+
+#ifndef PVN_SOLICIT_MAX_DELAY
+#define PVN_SOLICIT_MAX_DELAY (CLOCK_SECOND/8) //maximal (random) delay of an answer to a solicitation
+#endif
+#ifndef PVN_SOLICIT_WINDOW
+#define PVN_SOLICIT_WINDOW (3*CLOCK_SECOND/16) //time the soliciting node waits for the answers
+#endif
+
+#ifdef PVN_ANNOUNCED_VALIDITY
+#define PVN_HEADER_SIZE 1 //announced interval in seconds
+#else
+#define PVN_HEADER_SIZE 0
+#endif
+#ifndef PVN_MISSED_BEACONS
+#define PVN_MISSED_BEACONS 3 //announced intervals without a beacon until an entry is outdated
+#endif
 
 #ifndef CHECK_ALLOCATION
 #define CHECK_ALLOCATION(x)	if( (x) == 0 ) { printf("MEMORY ALLOCATION FAILED. EXPECT THE UNEXPECTED!\n"); }
@@ -52,6 +108,10 @@ struct Nbr{
 	void *public_var;
 	struct Nbr* nextNbr;
 	unsigned long timestamp;
+	int8_t rssi; //RSSI of the last received beacon (link quality)
+#ifdef PVN_ANNOUNCED_VALIDITY
+	uint16_t validity; //seconds after the last beacon in which the entry is valid (announced by the neighbor)
+#endif
 };
 
 /**
@@ -61,6 +121,7 @@ struct PVN_callbacks {
 	void (*onChange)(struct Nbr*);
 	void (*onNew)(struct Nbr*);
 	void (*onDelete)(struct Nbr*);
+	void (*onUpdate)(struct Nbr*); //optional, called for every received public variable (also if unchanged)
 };
 
 /**
@@ -82,6 +143,9 @@ struct PVN {
 	uint16_t port;
 	struct broadcast_conn broadcast; 
 	uint8_t online;
+#ifdef PVN_ANNOUNCED_VALIDITY
+	uint8_t announced_interval; //seconds until the next own beacon, sent with every beacon
+#endif
 
 	//UDFs
 	uint8_t (*cmp)(void*, void*);
@@ -89,6 +153,12 @@ struct PVN {
 
 	//Make the neighborhoods to a list for managing them.
 	struct PVN* next;
+
+	struct ctimer broadcast_timer; //expedited broadcast (e.g. the answer to a solicitation)
+
+	//Appendix of the beacons
+	uint8_t (*write_appendix)(uint8_t*, uint8_t);
+	void (*read_appendix)(struct Nbr*, uint8_t*, uint8_t);
 };
 //linked list of all open public variable neighborhoods
 struct PVN* list_of_all_public_variable_neighborhoods = 0;
@@ -140,6 +210,77 @@ struct Nbr* pvn_getNbr(struct PVN* pvn, uint16_t id)
 }
 
 
+void pvn_broadcast(struct PVN* pvn);
+
+//Sends the expedited broadcast
+static void pvn_on_broadcast_timeout(void* ptr)
+{
+	pvn_broadcast((struct PVN*) ptr);
+}
+
+/**
+ * Broadcasts the public variable after a random delay of at most max_delay ticks (in addition to the regular broadcasts).
+ * If an expedited broadcast is already pending, it is shared. Returns the delay (0 if it is shared).
+ */
+clock_time_t pvn_expedite(struct PVN* pvn, clock_time_t max_delay)
+{
+	if(pvn->variable == 0 || ctimer_expired(&(pvn->broadcast_timer)) == 0) return 0;
+	clock_time_t delay = timing_between(1, max_delay);
+	ctimer_set(&(pvn->broadcast_timer), delay, pvn_on_broadcast_timeout, pvn);
+	return delay;
+}
+
+#ifdef PVN_SOLICITATION
+//Schedules the answer to a solicitation. Multiple solicitations share one answer.
+static void pvn_on_solicitation(struct PVN* pvn, uint16_t from)
+{
+	clock_time_t delay = pvn_expedite(pvn, PVN_SOLICIT_MAX_DELAY);
+	if(delay != 0) TRACE_EVENT(TRACE_SOLICIT, 0, from, delay);
+}
+
+/**
+ * Asks the neighbors to broadcast their public variables now (instead of at the end of their period). The answers arrive
+ * within PVN_SOLICIT_MAX_DELAY ticks (plus the delay of the MAC layer). The PVN has to be online to receive them.
+ */
+void pvn_solicit(struct PVN* pvn)
+{
+	packetbuf_clear();
+	broadcast_send(&(pvn->broadcast));
+	RADIO_ENERGY_TX(RADIO_ENERGY_PVN, 0);
+	TRACE_EVENT(TRACE_SOLICIT, 0, 0, 0);
+}
+#endif
+
+//Updates the entry of a neighbor with a received public variable and calls the callbacks
+static void pvn_update_entry(struct PVN* pvn, struct Nbr* nbr, uint8_t* data)
+{
+	nbr->timestamp = clock_seconds();
+	if(nbr->public_var==0) {//No old public variable
+		nbr->public_var = calloc(1, pvn->size_of_variable);
+		CHECK_ALLOCATION( nbr->public_var );
+		memcpy(nbr->public_var, data, pvn->size_of_variable);
+		TRACE_EVENT(TRACE_NBR_NEW, 0, nbr->id, 0);
+		if(pvn->callbacks.onNew!=0) {
+			(*(pvn->callbacks.onNew))(nbr);
+			pvn->neighborhood_size++;
+		}
+	} else {
+		//check if public variable has changed
+		if((pvn->cmp == 0 && memcmp(nbr->public_var, data, pvn->size_of_variable)!=0) 
+				|| (pvn->cmp!=0 && (*(pvn->cmp))(nbr->public_var, data)!=0)) {
+			//Change happened
+			TRACE_EVENT(TRACE_NBR_CHANGE, 0, nbr->id, 0);
+			if(pvn->callbacks.onChange!=0) {
+				(*(pvn->callbacks.onChange))(nbr);
+			}
+		}
+		memcpy(nbr->public_var, data, pvn->size_of_variable);
+	}
+	if(pvn->callbacks.onUpdate!=0) {
+		(*(pvn->callbacks.onUpdate))(nbr);
+	}
+}
+
 /**
  * Is called if new neighbor information arrive on one of the communication channels.
  * Unfortunately we can not automatically generate one function per neighborhood.
@@ -147,9 +288,24 @@ struct Nbr* pvn_getNbr(struct PVN* pvn, uint16_t id)
 void on_new_neighbor_information(struct broadcast_conn *c, const linkaddr_t *from)
 {
 	uint16_t id = from->u8[0]<<8 | from->u8[1]; //decode id
+	RADIO_ENERGY_RX(RADIO_ENERGY_PVN, packetbuf_datalen());
 	struct PVN* tmp = list_of_all_public_variable_neighborhoods;
 	while(tmp!=0) {
 		if(&(tmp->broadcast) == c) {
+			RECORD_FRAME(tmp->port, from);
+#ifdef PVN_SOLICITATION
+			if(packetbuf_datalen() == 0) { //solicitation, the neighbor wants to hear the public variable now
+				pvn_on_solicitation(tmp, id);
+				return;
+			}
+#endif
+			//reject malformed frames (e.g. truncated by interference) before anything is allocated or copied
+			if(packetbuf_datalen() < tmp->size_of_variable + PVN_HEADER_SIZE
+					|| (packetbuf_datalen() > tmp->size_of_variable + PVN_HEADER_SIZE && tmp->read_appendix == 0)) {
+				TRACE_EVENT(TRACE_MALFORMED, tmp->port & 0xff, id, packetbuf_datalen());
+				return;
+			}
+			uint8_t* data = (uint8_t*) packetbuf_dataptr() + PVN_HEADER_SIZE; //the public variable
 			//find nbr or create it
 			if(tmp->nbrList == 0) { //No neighbors yet
 				//create entry for this robot with empty data
@@ -161,34 +317,23 @@ void on_new_neighbor_information(struct broadcast_conn *c, const linkaddr_t *fro
 			struct Nbr* nbr = pvn_getNbrs(tmp);
 			for(; nbr; nbr=nbr->nextNbr) {
 				if(nbr->id == id) { //found
-					//update entry
-					nbr->timestamp = clock_seconds();
-					if(nbr->public_var==0) {//No old public variable
-						nbr->public_var = calloc(1, tmp->size_of_variable);
-						CHECK_ALLOCATION( nbr->public_var );
-						memcpy(nbr->public_var, packetbuf_dataptr(), tmp->size_of_variable);
-						if(tmp->callbacks.onNew!=0) {
-							(*(tmp->callbacks.onNew))(nbr);
-							tmp->neighborhood_size++;
-						}
-					} else {
-						//check if public variable has changed
-						if((tmp->cmp == 0 && memcmp(nbr->public_var, packetbuf_dataptr(), tmp->size_of_variable)!=0) 
-								|| (tmp->cmp!=0 && (*(tmp->cmp))(nbr->public_var, packetbuf_dataptr())!=0)) {
-							//Change happened
-							if(tmp->callbacks.onChange!=0) {
-								(*(tmp->callbacks.onChange))(nbr);
-							}
-						}
-						memcpy(nbr->public_var, packetbuf_dataptr(), tmp->size_of_variable);
+					nbr->rssi = (int8_t) packetbuf_attr(PACKETBUF_ATTR_RSSI);
+#ifdef PVN_ANNOUNCED_VALIDITY
+					nbr->validity = ((uint8_t*) packetbuf_dataptr())[0]*PVN_MISSED_BEACONS + 1; //+1 for the rounding of clock_seconds
+#endif
+					//the appendix is read first, the callbacks of the neighborhood may use the packetbuf
+					if(packetbuf_datalen() > tmp->size_of_variable + PVN_HEADER_SIZE) {
+						(*(tmp->read_appendix))(nbr, data + tmp->size_of_variable,
+								packetbuf_datalen() - tmp->size_of_variable - PVN_HEADER_SIZE);
 					}
+					pvn_update_entry(tmp, nbr, data);
 					return;
 				} else if(nbr->nextNbr == 0) {//not in list
 					//Create an empty entry only with the base informations. Further informations are added in the next for-iteration (which finds this entry)
 					nbr->nextNbr = (struct Nbr*) calloc(1, sizeof(struct Nbr));
 					CHECK_ALLOCATION( nbr->nextNbr );
 					nbr->nextNbr->id = id;
-					linkaddr_copy(&(nbr->addr), from);
+					linkaddr_copy(&(nbr->nextNbr->addr), from);
 				}
 			}
 		}
@@ -198,6 +343,18 @@ void on_new_neighbor_information(struct broadcast_conn *c, const linkaddr_t *fro
 }
 static struct broadcast_callbacks pvn_broadcast_callbacks = {on_new_neighbor_information};
 
+/**
+ * Updates a known neighbor with its public variable that has been received by other means than its beacon (e.g. in an
+ * acknowledgement), like a received beacon. Returns 0 if the neighbor is unknown (no entry is created).
+ */
+uint8_t pvn_refresh(struct PVN* pvn, uint16_t id, void* variable)
+{
+	struct Nbr* nbr = pvn_getNbr(pvn, id);
+	if(nbr == 0 || nbr->public_var == 0) return 0;
+	pvn_update_entry(pvn, nbr, (uint8_t*) variable);
+	return 1;
+}
+
 /**
  * Returns 1 iff it is online, otherwise 0
  */
@@ -213,6 +370,8 @@ void pvn_set_online(struct PVN* pvn)
 {
 	if(pvn->online==0) {
 		broadcast_open(&(pvn->broadcast), pvn->port, &pvn_broadcast_callbacks);
+		RADIO_ENERGY_OPEN(RADIO_ENERGY_PVN);
+		RADIO_POWER_ACQUIRE(RADIO_POWER_PVN);
 		pvn->online = 1;
 	}
 }
@@ -224,10 +383,42 @@ void pvn_set_offline(struct PVN* pvn)
 {
 	if(pvn->online!=0) {
 		broadcast_close(&(pvn->broadcast));
+		RADIO_ENERGY_CLOSE(RADIO_ENERGY_PVN);
+		RADIO_POWER_RELEASE(RADIO_POWER_PVN);
 		pvn->online = 0;
 	}
 }
 
+/**
+ * Changes the age in seconds with which a neighbor entry is outdated (see pvn_init).
+ * Outdated entries are removed on the next call of pvn_remove_old_neighbor_information.
+ */
+void pvn_set_max_age(struct PVN* pvn, uint8_t maxAge)
+{
+	pvn->maximum_age_of_neighbor_information = maxAge;
+}
+
+#ifdef PVN_ANNOUNCED_VALIDITY
+/**
+ * Sets the time in seconds until the next own beacon. It is sent with every beacon, the neighbors keep the entry of this
+ * node for PVN_MISSED_BEACONS such intervals (but at least for their maximum age).
+ */
+void pvn_set_announced_interval(struct PVN* pvn, uint8_t seconds)
+{
+	pvn->announced_interval = seconds;
+}
+#endif
+
+/**
+ * Sets the functions that write the appendix of the own beacons and read the one of received beacons (0 for none).
+ * write gets the free space and returns the number of written bytes, read gets the neighbor, the appendix and its length.
+ */
+void pvn_set_appendix(struct PVN* pvn, uint8_t (*write)(uint8_t*, uint8_t), void (*read)(struct Nbr*, uint8_t*, uint8_t))
+{
+	pvn->write_appendix = write;
+	pvn->read_appendix = read;
+}
+
 /**
  * Initializes the PVN. Also switches is online.
  * @param pvn 	The PVN to be initialized. Has to be new.
@@ -269,17 +460,32 @@ void pvn_broadcast(struct PVN* pvn)
 	//open the channel temporarily if closed
 	if(pvn->online==0) {
 		broadcast_open(&(pvn->broadcast), pvn->port, &pvn_broadcast_callbacks);
+		RADIO_ENERGY_OPEN(RADIO_ENERGY_PVN);
+		//the frame is sent asynchronously by the MAC layer, keep the radio on until it is out
+		RADIO_POWER_HOLD(RADIO_POWER_PVN, RADIO_POWER_TX_HOLD);
 	}
 
 	//Send
 	if(pvn->variable!=0) {
-		packetbuf_copyfrom(pvn->variable, pvn->size_of_variable);
+		packetbuf_clear();
+		uint8_t* frame = (uint8_t*) packetbuf_dataptr();
+		uint16_t len = pvn->size_of_variable + PVN_HEADER_SIZE;
+#ifdef PVN_ANNOUNCED_VALIDITY
+		frame[0] = pvn->announced_interval;
+#endif
+		memcpy(frame + PVN_HEADER_SIZE, pvn->variable, pvn->size_of_variable);
+		if(pvn->write_appendix != 0 && len < PACKETBUF_SIZE) {
+			len += (*(pvn->write_appendix))(frame + len, (PACKETBUF_SIZE - len) > 255 ? 255 : PACKETBUF_SIZE - len);
+		}
+		packetbuf_set_datalen(len);
 		broadcast_send(&(pvn->broadcast));
+		RADIO_ENERGY_TX(RADIO_ENERGY_PVN, len);
 	}
 
 	//close channel again if pvn is offline
 	if(pvn->online==0) {
 		broadcast_close(&(pvn->broadcast));
+		RADIO_ENERGY_CLOSE(RADIO_ENERGY_PVN);
 	}
 }
 
@@ -297,6 +503,17 @@ void pvn_increaseNbrAge(struct Nbr* n, uint8_t seconds)
 
 
 
+//Returns 1 iff the entry is outdated. With PVN_ANNOUNCED_VALIDITY it is kept as long as announced by the neighbor.
+static uint8_t pvn_is_outdated(struct PVN* pvn, struct Nbr* nbr, unsigned long oldest_timestamp_allowed)
+{
+	if(nbr->timestamp >= oldest_timestamp_allowed) return 0;
+#ifdef PVN_ANNOUNCED_VALIDITY
+	//a maximum age of 0 removes all entries (pvn_destroy)
+	if(pvn->maximum_age_of_neighbor_information != 0 && clock_seconds() - nbr->timestamp <= nbr->validity) return 0;
+#endif
+	return 1;
+}
+
 /**
  * Goes through the neighborhood entries and removes all entries that are above the maximum age of neighbor informations.
  * Has to be called frequently
@@ -309,8 +526,9 @@ void pvn_remove_old_neighbor_information(struct PVN* pvn)
 	struct Nbr* nbr = pvn_getNbrs(pvn);
 	//remove the outdated entries in the beginning such that the list is either empty or the first entry is not outdated
 	while(nbr!=0) {
-		if(nbr->timestamp<oldest_timestamp_allowed) {
+		if(pvn_is_outdated(pvn, nbr, oldest_timestamp_allowed)) {
 			//delete nbr
+			TRACE_EVENT(TRACE_NBR_DELETE, 0, nbr->id, 0);
 			if(pvn->callbacks.onDelete!=0) {
 				(*(pvn->callbacks.onDelete))(nbr);//Notify
 				pvn->neighborhood_size--;
@@ -325,8 +543,9 @@ void pvn_remove_old_neighbor_information(struct PVN* pvn)
 	}
 	//remove the outdated entries further behind
 	for(; nbr!=0 && pvn_getNextNbr(nbr)!=0; nbr= pvn_getNextNbr(nbr)) {
-		if(nbr->nextNbr->timestamp<oldest_timestamp_allowed) {
+		if(pvn_is_outdated(pvn, nbr->nextNbr, oldest_timestamp_allowed)) {
 			struct Nbr* tmp = nbr->nextNbr;
+			TRACE_EVENT(TRACE_NBR_DELETE, 0, tmp->id, 0);
 			if(pvn->callbacks.onDelete!=0) {
 				(*(pvn->callbacks.onDelete))(tmp);//Notify
 				pvn->neighborhood_size--;
@@ -346,6 +565,7 @@ void pvn_destroy(struct PVN* pvn)
 {
 	//close network
 	pvn_set_offline(pvn);
+	ctimer_stop(&(pvn->broadcast_timer));
 
 	//find entry in list and remove it
 	if(list_of_all_public_variable_neighborhoods == pvn) { 
@@ -371,6 +591,33 @@ uint16_t pvn_neighborhood_size(struct PVN* pvn)
 	return pvn->neighborhood_size;	
 }
 
+//Hashes the id and the first size bytes of a public variable
+static uint8_t pvn_digest_of(uint16_t id, uint8_t* var, uint8_t size)
+{
+	uint8_t h = (id>>8) ^ (id & 0xff) ^ 0x5a;
+	uint8_t i;
+	for(i=0; i<size; i++) {
+		h = (h<<1 | h>>7) ^ var[i]; //rotate and xor
+		h += 0x3b;
+	}
+	return h;
+}
+
+/**
+ * Returns a digest of the state of the neighborhood: the own public variable and the ones of all neighbors. Only the first
+ * size bytes of each variable are considered, so a digest that is part of the public variable can be excluded by placing
+ * it at the end. The digest does not depend on the order of the neighbors.
+ */
+uint8_t pvn_digest(struct PVN* pvn, uint8_t size)
+{
+	uint8_t digest = pvn_digest_of(0, (uint8_t*) pvn->variable, size);
+	struct Nbr* nbr = pvn_getNbrs(pvn);
+	for(; nbr!=0; nbr=pvn_getNextNbr(nbr)) {
+		if(nbr->public_var != 0) digest += pvn_digest_of(nbr->id, (uint8_t*) nbr->public_var, size);
+	}
+	return digest;
+}
+
 /**
  * Prints some informations to the serial port for debugging.
  */
@@ -11,7 +11,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "public_variable_neighborhood.h"
-#include "lib/random.h"
+#include "../timing/timing.h"
 
 //The public variable
 struct maxIdPubVar{
@@ -46,11 +46,11 @@ PROCESS_THREAD(example_pvn_process, ev, data)
 	pvn_setCallbacks(&pvn, cbs); //Set the above callbacks
 
 	pv.maxId = (linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1]; //set max id to own id
-	random_init(pv.maxId); //init the random generator for random sleep time (important in Cooja)
+	timing_seed(pv.maxId); //init the random generator for random sleep time (important in Cooja)
 
 	while(1) {
 		//Sleep random time (0,2) seconds
-		etimer_set(&et, 2*CLOCK_SECOND*((float)random_rand()/RANDOM_RAND_MAX));
+		etimer_set(&et, timing_random(2*CLOCK_SECOND));
 		PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
 
 		//Remove outdated entries
@@ -0,0 +1,210 @@
+/**
+ * MODULE OF mlst_network.h
+ *
+ * Radio energy accounting. Tracks for each component (PVN beacons, rsunicast data, rsunicast ACKs) how long its channels
+ * have been open and how many bytes/frames it sent and received. From the bytes the air time is estimated, the remaining
+ * time in which any channel is open is accounted as idle listening.
+ *
+ * The accounting is only compiled in if `RADIO_ENERGY_ACCOUNTING` is defined. Otherwise all hooks are empty.
+ * The times are measured with clock_time(), thus a channel that is only opened for sending a single frame (e.g. the beacon
+ * of an offline PVN) may be accounted with 0 on-time but its air time is still counted.
+ *
+ * User Functions:
+ * ---------------------------
+ * void radio_energy_get(uint8_t component, struct radio_energy_stats* stats); //Returns the current values of a component
+ * unsigned long radio_energy_radio_on_ms(); //Time in which at least one channel has been open
+ * unsigned long radio_energy_idle_listening_ms(); //Radio on time without estimated air time
+ * void radio_energy_reset(); //Sets all counters to zero (open channels stay accounted as open)
+ * void radio_energy_print_state(); //Prints the values of all components
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef RADIO_ENERGY_H
+#define RADIO_ENERGY_H
+
+#include "contiki.h"
+#include <stdio.h>
+#include <string.h>
+
+//The components to which the radio usage is attributed
+#define RADIO_ENERGY_PVN 0
+#define RADIO_ENERGY_RSU_DATA 1
+#define RADIO_ENERGY_RSU_ACK 2
+#define RADIO_ENERGY_COMPONENTS 3
+
+//Air time of a byte in microseconds (250kbit/s of IEEE 802.15.4)
+#ifndef RADIO_ENERGY_US_PER_BYTE
+#define RADIO_ENERGY_US_PER_BYTE 32
+#endif
+//Bytes added to each frame by the lower layers (PHY header, MAC header, Rime header, CRC)
+#ifndef RADIO_ENERGY_FRAME_OVERHEAD
+#define RADIO_ENERGY_FRAME_OVERHEAD 25
+#endif
+
+#ifdef RADIO_ENERGY_ACCOUNTING
+
+/**
+ * The values of a component as returned by radio_energy_get
+ */
+struct radio_energy_stats {
+	unsigned long on_ms; //time with open channel
+	unsigned long tx_bytes;
+	unsigned long rx_bytes;
+	uint16_t tx_frames;
+	uint16_t rx_frames;
+	unsigned long airtime_ms; //estimated time for sending and receiving
+};
+
+//Accounting of a single component
+struct radio_energy {
+	unsigned long on_ticks; //finished on periods
+	clock_time_t on_since; //begin of the current on period
+	uint8_t open_channels; //number of currently open channels of this component
+	unsigned long tx_bytes;
+	unsigned long rx_bytes;
+	uint16_t tx_frames;
+	uint16_t rx_frames;
+};
+
+//**VARIABLES**
+struct radio_energy radio_energy[RADIO_ENERGY_COMPONENTS];
+unsigned long radio_energy_any_on_ticks = 0; //finished periods in which any channel has been open
+clock_time_t radio_energy_any_on_since = 0;
+uint8_t radio_energy_open_channels = 0; //number of open channels of all components
+//--VARIABLES--
+
+static unsigned long radio_energy_ticks_to_ms(unsigned long ticks)
+{
+	return (ticks/CLOCK_SECOND)*1000 + ((ticks%CLOCK_SECOND)*1000)/CLOCK_SECOND;
+}
+
+/**
+ * Has to be called when a channel of the component is opened
+ */
+void radio_energy_channel_open(uint8_t component)
+{
+	struct radio_energy* e = &radio_energy[component];
+	if(e->open_channels++ == 0) e->on_since = clock_time();
+	if(radio_energy_open_channels++ == 0) radio_energy_any_on_since = clock_time();
+}
+
+/**
+ * Has to be called when a channel of the component is closed
+ */
+void radio_energy_channel_close(uint8_t component)
+{
+	struct radio_energy* e = &radio_energy[component];
+	if(e->open_channels == 0) return;
+	if(--e->open_channels == 0) e->on_ticks += clock_time() - e->on_since;
+	if(--radio_energy_open_channels == 0) radio_energy_any_on_ticks += clock_time() - radio_energy_any_on_since;
+}
+
+/**
+ * Has to be called for each sent frame
+ */
+void radio_energy_tx(uint8_t component, uint16_t bytes)
+{
+	radio_energy[component].tx_bytes += bytes;
+	radio_energy[component].tx_frames++;
+}
+
+/**
+ * Has to be called for each received frame
+ */
+void radio_energy_rx(uint8_t component, uint16_t bytes)
+{
+	radio_energy[component].rx_bytes += bytes;
+	radio_energy[component].rx_frames++;
+}
+
+/**
+ * Writes the current values of the component to stats. Periods that are still running are included.
+ */
+void radio_energy_get(uint8_t component, struct radio_energy_stats* stats)
+{
+	struct radio_energy* e = &radio_energy[component];
+	unsigned long ticks = e->on_ticks;
+	if(e->open_channels > 0) ticks += clock_time() - e->on_since;
+	stats->on_ms = radio_energy_ticks_to_ms(ticks);
+	stats->tx_bytes = e->tx_bytes;
+	stats->rx_bytes = e->rx_bytes;
+	stats->tx_frames = e->tx_frames;
+	stats->rx_frames = e->rx_frames;
+	stats->airtime_ms = ((e->tx_bytes + e->rx_bytes + (unsigned long)(e->tx_frames + e->rx_frames)*RADIO_ENERGY_FRAME_OVERHEAD)
+			*RADIO_ENERGY_US_PER_BYTE)/1000;
+}
+
+/**
+ * Returns the time in ms in which at least one channel has been open
+ */
+unsigned long radio_energy_radio_on_ms()
+{
+	unsigned long ticks = radio_energy_any_on_ticks;
+	if(radio_energy_open_channels > 0) ticks += clock_time() - radio_energy_any_on_since;
+	return radio_energy_ticks_to_ms(ticks);
+}
+
+/**
+ * Returns the time in ms in which a channel has been open but nothing has been sent or received
+ */
+unsigned long radio_energy_idle_listening_ms()
+{
+	unsigned long airtime = 0;
+	uint8_t i;
+	struct radio_energy_stats stats;
+	for(i=0; i<RADIO_ENERGY_COMPONENTS; i++) {
+		radio_energy_get(i, &stats);
+		airtime += stats.airtime_ms;
+	}
+	unsigned long on = radio_energy_radio_on_ms();
+	return (on > airtime ? on - airtime : 0);
+}
+
+/**
+ * Sets all counters to zero. Channels that are open stay accounted as open from now on.
+ */
+void radio_energy_reset()
+{
+	uint8_t i;
+	for(i=0; i<RADIO_ENERGY_COMPONENTS; i++) {
+		uint8_t open_channels = radio_energy[i].open_channels;
+		memset(&radio_energy[i], 0, sizeof(struct radio_energy));
+		radio_energy[i].open_channels = open_channels;
+		radio_energy[i].on_since = clock_time();
+	}
+	radio_energy_any_on_ticks = 0;
+	radio_energy_any_on_since = clock_time();
+}
+
+/**
+ * Prints the values of all components in one line, e.g.
+ * ENERGY[PVN:(on=1000ms, tx=3/12B, rx=10/40B), DATA:(...), ACK:(...), RADIO_ON=1200ms, IDLE=1150ms]
+ */
+void radio_energy_print_state()
+{
+	static const char* names[RADIO_ENERGY_COMPONENTS] = {"PVN", "DATA", "ACK"};
+	struct radio_energy_stats stats;
+	uint8_t i;
+	printf("ENERGY[");
+	for(i=0; i<RADIO_ENERGY_COMPONENTS; i++) {
+		radio_energy_get(i, &stats);
+		printf("%s:(on=%lums, tx=%u/%luB, rx=%u/%luB), ", names[i], stats.on_ms, stats.tx_frames, stats.tx_bytes, stats.rx_frames, stats.rx_bytes);
+	}
+	printf("RADIO_ON=%lums, IDLE=%lums]\n", radio_energy_radio_on_ms(), radio_energy_idle_listening_ms());
+}
+
+#define RADIO_ENERGY_OPEN(c) radio_energy_channel_open(c)
+#define RADIO_ENERGY_CLOSE(c) radio_energy_channel_close(c)
+#define RADIO_ENERGY_TX(c, bytes) radio_energy_tx(c, bytes)
+#define RADIO_ENERGY_RX(c, bytes) radio_energy_rx(c, bytes)
+#else
+#define RADIO_ENERGY_OPEN(c)
+#define RADIO_ENERGY_CLOSE(c)
+#define RADIO_ENERGY_TX(c, bytes)
+#define RADIO_ENERGY_RX(c, bytes)
+#endif
+
+#endif
@@ -0,0 +1,190 @@
+/**
+ * MODULE OF mlst_network.h
+ *
+ * Reference counted power manager of the radio. Closing the Rime connections (as the PVN and rsunicast do for sleeping)
+ * only stops the delivery, the transceiver (and the radio duty cycling) keeps running. With this module the users of the
+ * radio (PVN, rsunicast and the application) acquire and release it and the radio is switched off through the netstack
+ * (NETSTACK_RDC.off(0)) as soon as no one needs it. Acquiring switches it on synchronously (NETSTACK_RDC.on()), thus
+ * rsunicast_send can send without additional latency.
+ *
+ * Frames that are handed to Rime are sent asynchronously by the MAC/RDC layer (e.g. ContikiMAC strobes for a whole
+ * cycle). A user that only sends a single frame (e.g. the beacon of an offline PVN) therefore keeps the radio on for
+ * RADIO_POWER_TX_HOLD ticks after the send with radio_power_hold().
+ *
+ * The power manager is only compiled in if `RADIO_POWER_MANAGER` is defined. Otherwise all hooks are empty and the radio
+ * is never switched off. The actual on and off time of the radio is recorded (from radio_power_init()).
+ *
+ * User Functions:
+ * ---------------------------
+ * void radio_power_init(); //Starts the accounting. Called by mlst_init().
+ * void radio_power_acquire(uint8_t user); //The user needs the radio (counted, every acquire needs a release)
+ * void radio_power_release(uint8_t user); //The user does not need the radio any longer
+ * void radio_power_hold(uint8_t user, clock_time_t ticks); //Keeps the radio on for the given time (e.g. after sending)
+ * uint8_t radio_power_is_on(); //1 iff the radio is switched on
+ * unsigned long radio_power_on_ms(); //Time in which the radio has been switched on
+ * unsigned long radio_power_off_ms(); //Time in which the radio has been switched off
+ * void radio_power_print_state(); //Prints the on/off time and the current users
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef RADIO_POWER_H
+#define RADIO_POWER_H
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "sys/ctimer.h"
+#include <stdio.h>
+
+//The users of the radio
+#define RADIO_POWER_PVN 0
+#define RADIO_POWER_RSU 1
+#define RADIO_POWER_APP 2
+#define RADIO_POWER_USERS 3
+
+//Time the radio is kept on after a single frame has been handed to Rime (one ContikiMAC cycle at 8 Hz)
+#ifndef RADIO_POWER_TX_HOLD
+#define RADIO_POWER_TX_HOLD (CLOCK_SECOND/8)
+#endif
+
+#ifdef RADIO_POWER_MANAGER
+
+//**VARIABLES**
+uint8_t radio_power_users[RADIO_POWER_USERS]; //number of acquires without release per user
+uint8_t radio_power_held[RADIO_POWER_USERS]; //1 iff the hold timer of the user is running (and counted as acquire)
+struct ctimer radio_power_hold_timer[RADIO_POWER_USERS];
+uint8_t radio_power_on = 1; //Contiki starts with the radio on
+unsigned long radio_power_on_ticks = 0; //finished on periods
+unsigned long radio_power_off_ticks = 0; //finished off periods
+clock_time_t radio_power_since = 0; //begin of the current period
+uint16_t radio_power_switches = 0; //number of switches on or off
+//--VARIABLES--
+
+//Switches the radio to the given state and accounts the finished period
+static void radio_power_switch(uint8_t on)
+{
+	if(on == radio_power_on) return;
+	if(radio_power_on) radio_power_on_ticks += clock_time() - radio_power_since;
+	else radio_power_off_ticks += clock_time() - radio_power_since;
+	radio_power_since = clock_time();
+	radio_power_switches++;
+	radio_power_on = on;
+	if(on) NETSTACK_RDC.on();
+	else NETSTACK_RDC.off(0);
+}
+
+//Switches the radio off if no user needs it any longer
+static void radio_power_update()
+{
+	uint8_t i;
+	for(i=0; i<RADIO_POWER_USERS; i++) {
+		if(radio_power_users[i] > 0) {
+			radio_power_switch(1);
+			return;
+		}
+	}
+	radio_power_switch(0);
+}
+
+/**
+ * The user needs the radio. It is switched on immediately if it is off.
+ */
+void radio_power_acquire(uint8_t user)
+{
+	radio_power_users[user]++;
+	radio_power_switch(1);
+}
+
+/**
+ * The user does not need the radio any longer. It is switched off if this has been the last user.
+ */
+void radio_power_release(uint8_t user)
+{
+	if(radio_power_users[user] == 0) return;
+	radio_power_users[user]--;
+	radio_power_update();
+}
+
+//Ends the hold of a user
+static void radio_power_on_hold_timeout(void* ptr)
+{
+	uint8_t user = (uint8_t)(uintptr_t) ptr;
+	radio_power_held[user] = 0;
+	radio_power_release(user);
+}
+
+/**
+ * Keeps the radio on for the given time for the user (e.g. until a frame has been sent by the MAC layer). A running hold
+ * of the user is extended.
+ */
+void radio_power_hold(uint8_t user, clock_time_t ticks)
+{
+	if(radio_power_held[user] == 0) {
+		radio_power_acquire(user);
+		radio_power_held[user] = 1;
+	}
+	ctimer_set(&radio_power_hold_timer[user], ticks, radio_power_on_hold_timeout, (void*)(uintptr_t) user);
+}
+
+/**
+ * Returns 1 iff the radio is switched on.
+ */
+uint8_t radio_power_is_on()
+{
+	return radio_power_on;
+}
+
+/**
+ * Returns the time in ms in which the radio has been switched on (since radio_power_init).
+ */
+unsigned long radio_power_on_ms()
+{
+	unsigned long ticks = radio_power_on_ticks;
+	if(radio_power_on) ticks += clock_time() - radio_power_since;
+	return (ticks/CLOCK_SECOND)*1000 + ((ticks%CLOCK_SECOND)*1000)/CLOCK_SECOND;
+}
+
+/**
+ * Returns the time in ms in which the radio has been switched off (since radio_power_init).
+ */
+unsigned long radio_power_off_ms()
+{
+	unsigned long ticks = radio_power_off_ticks;
+	if(radio_power_on == 0) ticks += clock_time() - radio_power_since;
+	return (ticks/CLOCK_SECOND)*1000 + ((ticks%CLOCK_SECOND)*1000)/CLOCK_SECOND;
+}
+
+/**
+ * Starts the accounting of the on/off time. Called by mlst_init(). Switches the radio off if no one has acquired it.
+ */
+void radio_power_init()
+{
+	radio_power_since = clock_time();
+	radio_power_on_ticks = 0;
+	radio_power_off_ticks = 0;
+	radio_power_update();
+}
+
+/**
+ * Prints the on/off time and the current number of acquires per user, e.g.
+ * RADIO_POWER[on=1200ms, off=8800ms, switches=20, users=(PVN:0, RSU:1, APP:0)]
+ */
+void radio_power_print_state()
+{
+	printf("RADIO_POWER[on=%lums, off=%lums, switches=%u, users=(PVN:%u, RSU:%u, APP:%u)]\n", radio_power_on_ms(),
+			radio_power_off_ms(), radio_power_switches, radio_power_users[RADIO_POWER_PVN], radio_power_users[RADIO_POWER_RSU],
+			radio_power_users[RADIO_POWER_APP]);
+}
+
+#define RADIO_POWER_ACQUIRE(user) radio_power_acquire(user)
+#define RADIO_POWER_RELEASE(user) radio_power_release(user)
+#define RADIO_POWER_HOLD(user, ticks) radio_power_hold(user, ticks)
+#else
+#define RADIO_POWER_ACQUIRE(user)
+#define RADIO_POWER_RELEASE(user)
+#define RADIO_POWER_HOLD(user, ticks)
+#endif
+
+#endif
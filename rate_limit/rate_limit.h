@@ -0,0 +1,184 @@
+/**
+ * MODULE OF mlst_network.h
+ *
+ * Admission control of the own messages (`#define MLST_RATE_LIMIT`). Without it mlst_send accepts every message, thus
+ * under overload the queues near the root grow, the retries collide and messages are dropped after MAX_TRIES.
+ *
+ * Every node has a token bucket of RATE_LIMIT_BURST messages that is refilled with the current rate (messages per minute).
+ * mlst_send takes one token, without a token the message is deferred: it is not copied and mlst_send returns
+ * MLST_DEFERRED, so the application can keep its reading, merge it with the next one or sample less often (mlst_rate).
+ * Forwarded messages, urgent and redundant messages are not limited.
+ *
+ * The rate is announced by the root (RATE_LIMIT_RATE) and passed down the tree: every beacon carries the rate of its
+ * sender (one byte, see mlst_write_appendix) and a node uses the minimum of the rate of its parent and its own limit. The
+ * own limit follows the load of the node (AIMD, once per period): it is halved while more than RATE_LIMIT_QUEUE_HIGH
+ * messages wait in the queue of rsunicast and increased by one otherwise. Thus a congested forwarder throttles its whole
+ * subtree, the other branches keep their rate. Nodes that have not heard the rate of their parent for
+ * RATE_LIMIT_MAX_UNSYNCED seconds only use their own limit. All nodes have to use the same setting.
+ *
+ * User Functions:
+ * ---------------------------
+ * void rate_limit_init(); //Fills the bucket. Called by mlst_init().
+ * void rate_limit_update(uint16_t queue_length); //Adapts the own limit to the length of the queue. Called once per period.
+ * uint8_t rate_limit_rate(); //The current rate in messages per minute (announced in the beacon)
+ * void rate_limit_sync(uint8_t rate); //Adopts the rate of the parent (received in its beacon)
+ * uint8_t rate_limit_admit(); //Takes a token, 0 if there is none (the message has to be deferred)
+ * void rate_limit_refund(); //Gives the token back if the admitted message has not been taken by rsunicast
+ * void rate_limit_print_state(); //Prints the rates, the tokens and the number of deferred messages
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef RATE_LIMIT_H
+#define RATE_LIMIT_H
+
+#include "contiki.h"
+#include <stdio.h>
+
+#ifdef MLST_RATE_LIMIT
+
+//Rate announced by the root in messages per minute per node (at most 254)
+#ifndef RATE_LIMIT_RATE
+#define RATE_LIMIT_RATE 12
+#endif
+//Size of the bucket, the number of messages that can be sent at once after a quiet phase
+#ifndef RATE_LIMIT_BURST
+#define RATE_LIMIT_BURST 4
+#endif
+//The own limit is not reduced below this rate
+#ifndef RATE_LIMIT_MIN_RATE
+#define RATE_LIMIT_MIN_RATE 1
+#endif
+//Length of the queue of rsunicast above which the own limit is halved
+#ifndef RATE_LIMIT_QUEUE_HIGH
+#define RATE_LIMIT_QUEUE_HIGH 4
+#endif
+//Time in seconds after the last beacon of the parent in which its rate is considered as valid
+#ifndef RATE_LIMIT_MAX_UNSYNCED
+#define RATE_LIMIT_MAX_UNSYNCED 120
+#endif
+
+#define RATE_LIMIT_UNKNOWN 0xff
+//The credit of one token: the rate is in messages per minute, the time in ticks
+#define RATE_LIMIT_TOKEN (60ul*CLOCK_SECOND)
+
+//**VARIABLES**
+uint8_t rate_limit_local = RATE_LIMIT_RATE; //the own limit (load of this node)
+uint8_t rate_limit_parent = RATE_LIMIT_UNKNOWN; //the rate announced by the parent
+unsigned long rate_limit_synced_at = 0; //clock_seconds() of the last beacon of the parent
+unsigned long rate_limit_credit = 0; //content of the bucket in 1/RATE_LIMIT_TOKEN tokens
+clock_time_t rate_limit_refilled_at = 0;
+uint16_t rate_limit_deferred = 0; //number of deferred messages
+//--VARIABLES--
+
+/**
+ * Fills the bucket.
+ */
+void rate_limit_init()
+{
+	rate_limit_credit = RATE_LIMIT_BURST*RATE_LIMIT_TOKEN;
+	rate_limit_refilled_at = clock_time();
+}
+
+/**
+ * Returns the current rate in messages per minute: the minimum of the own limit and the rate of the parent.
+ */
+uint8_t rate_limit_rate()
+{
+#ifndef ROOT
+	if(rate_limit_parent != RATE_LIMIT_UNKNOWN && clock_seconds() - rate_limit_synced_at > RATE_LIMIT_MAX_UNSYNCED) {
+		rate_limit_parent = RATE_LIMIT_UNKNOWN;
+	}
+	if(rate_limit_parent < rate_limit_local) return rate_limit_parent;
+#endif
+	return rate_limit_local;
+}
+
+//Adds the credit for the time since the last refill (with the current rate)
+static void rate_limit_refill()
+{
+	clock_time_t now = clock_time();
+	unsigned long elapsed = (clock_time_t)(now - rate_limit_refilled_at);
+	rate_limit_refilled_at = now;
+	if(elapsed >= RATE_LIMIT_BURST*RATE_LIMIT_TOKEN) { //full even with a rate of 1 (no overflow below)
+		rate_limit_credit = RATE_LIMIT_BURST*RATE_LIMIT_TOKEN;
+		return;
+	}
+	rate_limit_credit += elapsed*rate_limit_rate();
+	if(rate_limit_credit > RATE_LIMIT_BURST*RATE_LIMIT_TOKEN) rate_limit_credit = RATE_LIMIT_BURST*RATE_LIMIT_TOKEN;
+}
+
+/**
+ * Adapts the own limit to the length of the queue (additive increase, multiplicative decrease). Called once per period.
+ */
+void rate_limit_update(uint16_t queue_length)
+{
+	rate_limit_refill(); //with the old rate
+	if(queue_length > RATE_LIMIT_QUEUE_HIGH) {
+		rate_limit_local /= 2;
+		if(rate_limit_local < RATE_LIMIT_MIN_RATE) rate_limit_local = RATE_LIMIT_MIN_RATE;
+	} else if(rate_limit_local < RATE_LIMIT_RATE) {
+		rate_limit_local++;
+	}
+}
+
+/**
+ * Adopts the rate of the parent (received in its beacon just now).
+ */
+void rate_limit_sync(uint8_t rate)
+{
+#ifndef ROOT
+	if(rate == RATE_LIMIT_UNKNOWN) return;
+	rate_limit_refill(); //with the old rate
+	rate_limit_parent = rate;
+	rate_limit_synced_at = clock_seconds();
+#endif
+}
+
+/**
+ * Takes a token for a message. Returns 0 if the bucket is empty, then the message has to be deferred.
+ */
+uint8_t rate_limit_admit()
+{
+	rate_limit_refill();
+	if(rate_limit_credit < RATE_LIMIT_TOKEN) {
+		rate_limit_deferred++;
+		return 0;
+	}
+	rate_limit_credit -= RATE_LIMIT_TOKEN;
+	return 1;
+}
+
+/**
+ * Gives back the token of an admitted message that has not been taken (e.g. the own queue of RSUNICAST_FAIR_QUEUE is
+ * full). Otherwise every refusal would lower the rate further while the node is congested.
+ */
+void rate_limit_refund()
+{
+	rate_limit_credit += RATE_LIMIT_TOKEN;
+	if(rate_limit_credit > RATE_LIMIT_BURST*RATE_LIMIT_TOKEN) rate_limit_credit = RATE_LIMIT_BURST*RATE_LIMIT_TOKEN;
+	rate_limit_deferred++;
+}
+
+/**
+ * Prints the state of the bucket, e.g.
+ * RATE_LIMIT[rate=6/min, own=6, parent=12, tokens=2, deferred=17]
+ */
+void rate_limit_print_state()
+{
+	printf("RATE_LIMIT[rate=%u/min, own=%u, parent=%u, tokens=%u, deferred=%u]\n", rate_limit_rate(), rate_limit_local,
+			rate_limit_parent, (unsigned int)(rate_limit_credit/RATE_LIMIT_TOKEN), rate_limit_deferred);
+}
+
+#define RATE_LIMIT_ADMIT() rate_limit_admit()
+#define RATE_LIMIT_REFUND() rate_limit_refund()
+#define RATE_LIMIT_UPDATE(queue_length) rate_limit_update(queue_length)
+#else
+#define RATE_LIMIT_ADMIT() 1
+#define RATE_LIMIT_REFUND()
+#define RATE_LIMIT_UPDATE(queue_length)
+#endif
+
+#endif
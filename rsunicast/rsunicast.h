@@ -14,15 +14,40 @@
  * End User Functions:
  * --------------------------
  * void rsunicast_init(); //initializes the rsunicast (i.e. opens the communication channels)
- * void rsunicast_send(void* msg, uint16_t size); //for sending a message to the sink of the MLST
+ * uint8_t rsunicast_send(void* msg, uint16_t size); //for sending a message to the sink of the MLST, 0 if it is discarded
  * void rsunicast_allowSleeping(); //Allows the rsunicast to sleep if it is idle (no messages can be received)
  * void rsunicast_disallowSleeping(); //Wakes the rsunicast up
  * void rsunicast_setparent(uint16_t id); //Sets the parent in the Sink-Tree
  * void rsunicast_setFailureCallback(void (*onLostMessageCB)(uint16_t id, uint8_t times)); //Sets the function that is called
  * 																if the last messages times out without an ACK
  * rsunicast_print_state(); //Prints some informations (messages in queue, ...)
+ * RSUNICAST_COUNTERS ONLY: void rsunicast_counters_snapshot(struct rsu_counters* c); //Performance counters, see ./rsunicast_counters.h
+ * MLST_RUNTIME_CONFIG ONLY: uint8_t rsunicast_set_parameter(const char* name, float value); //Sets TIMEOUT_IN_SEC or MAX_TRIES
  * ROOT ONLY: void rsunicast_setNewMessageCallback_root(void (*cb)(void* msg, uint16_t size)); //This callback is called on
  * 																			new incoming messages
+ * ROOT ONLY: uint16_t rsunicast_message_origin(); //Id of the node that has sent the message (only valid in the callback)
+ * ROOT ONLY: uint16_t rsunicast_message_sender(); //Id of the last hop of the message (only valid in the callback)
+ *
+ * void rsunicast_send_typed(uint8_t type, void* msg, uint16_t size); //Sends a message of an internal service (e.g. topology reports)
+ * RSUNICAST_BEACON_ACK ONLY: uint8_t rsunicast_send_urgent(void* msg, uint16_t size); //Like rsunicast_send, but always acknowledged immediately
+ * RSUNICAST_BEACON_ACK ONLY: void rsunicast_setBeaconAckCallbacks(uint8_t (*can_hear_beacons)(), void (*request_beacon)()); //Connects
+ * 																			the acknowledgements in beacons to the neighborhood (see ./rsunicast_beacon_ack.h)
+ * RSUNICAST_BEACON_ACK ONLY: uint8_t rsunicast_write_beacon_acks(uint8_t* buf, uint8_t max); //Writes the acknowledgements into a beacon
+ * RSUNICAST_BEACON_ACK ONLY: void rsunicast_on_beacon(uint16_t id, uint8_t* acks, uint8_t len); //Passes the acknowledgements of a received beacon
+ * RSUNICAST_OPPORTUNISTIC/RSUNICAST_MULTIPATH ONLY: void rsunicast_setCandidatesCallback(uint8_t (*cb)(uint16_t* ids, uint8_t max)); //Sets
+ * 																			the candidates for the next hop (see ./rsunicast_opportunistic.h)
+ * RSUNICAST_MULTIPATH ONLY: uint8_t rsunicast_send_redundant(void* msg, uint16_t size, uint8_t copies); //Sends copies over
+ * 																			different first hops, see ./rsunicast_multipath.h
+ * RSUNICAST_ACK_PAYLOAD ONLY: void rsunicast_setAckPayload(void* payload, uint8_t size); //Data that is appended to every sent ACK
+ * RSUNICAST_ACK_PAYLOAD ONLY: void rsunicast_setAckPayloadCallback(void (*cb)(uint16_t id, void* payload, uint8_t size)); //Called
+ * 																			for every received ACK with payload
+ * ROOT ONLY: void rsunicast_setTypedMessageCallback_root(void (*cb)(uint8_t type, void* msg, uint16_t size)); //Called for
+ * 																			messages that are not RSU_TYPE_DATA
+ *
+ * Each message is sent with a header of RSU_HEADER_SIZE bytes: the seqno of the hop (1 byte), the type of the message
+ * (1 byte, RSU_TYPE_*) and the id of the originating node (2 bytes, little endian). Type and origin are kept when forwarding.
+ * An ACK consists of RSU_ACK_SIZE bytes. With `#define RSUNICAST_ACK_PAYLOAD` it is followed by the payload set with
+ * rsunicast_setAckPayload (e.g. the public variable of the MLST, which proves that the parent is alive).
  *
  * @author Dominik Krupke, d.krupke@tu-bs.de
  * @year 2015
@@ -35,7 +60,15 @@
 
 #include "contiki.h"
 #include "net/rime/rime.h"
+#include <string.h>
 #include "rsunicast_history.h"
+#include "../radio_energy/radio_energy.h"
+#include "../radio_power/radio_power.h"
+#include "../cpu_power/cpu_power.h"
+#include "../convergecast/convergecast.h"
+#include "../timing/timing.h"
+#include "../trace/trace.h"
+#include "../trace/record.h"
 
 #ifndef CHECK_ALLOCATION
 #define CHECK_ALLOCATION(x)	if( (x) == 0 ){ printf("MEMORY ALLOCATION FAILED. EXPECT THE UNEXPECTED!\n"); }
@@ -46,15 +79,75 @@
 //Defines the communication port for sending and receiving acknowledgements for the use data messages
 #define ACKNOWLEDGEMENT_PORT 182
 //If after this time no acknowledgement has been received, the message times out and is either resent after some delay or discarded
+#ifndef TIMEOUT_IN_SEC
 #define TIMEOUT_IN_SEC 0.2
+#endif
 //The number of resends that are made before a message is discarded
+#ifndef MAX_TRIES
 #define MAX_TRIES 5
+#endif
 //The delay before a message is sent (randomized to prevent all nodes to send always at the same time)
 #define NEXT_MSG_DELAY 0.01
 //Extra delay for failed messages depending on number of retries. Is multiplied by tries^2 * rnd(0,1)
 #define DELAY_ON_FAIL_IN_SEC 0.1
+//The parameters in ticks, converted by the compiler (no floating point arithmetic when a timer is set, see ../timing/timing.h)
+#define RSU_TIMEOUT_TICKS TIMING_TICKS(TIMEOUT_IN_SEC)
+#define RSU_DELAY_ON_FAIL_TICKS TIMING_TICKS(DELAY_ON_FAIL_IN_SEC)
+#define RSU_NEXT_MSG_JITTER timing_between(TIMING_TICKS(NEXT_MSG_DELAY)/2, TIMING_TICKS(NEXT_MSG_DELAY)) //50-100% of NEXT_MSG_DELAY
+//Delay of the first transmission of a new message. Only an own message of a sleeping leaf shares the wake-up of the MLST
+//(CPU_POWER_MANAGER), forwarded messages and retries are not deferred (the radio of the backbone is on anyway).
+#define RSU_FIRST_SEND_DELAY(origin) ((rsu_is_allowed_to_sleep == 1 && \
+		(origin) == ((linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1])) ? CPU_POWER_COALESCE(RSU_NEXT_MSG_JITTER) : RSU_NEXT_MSG_JITTER)
+
+uint8_t rsunicast_send(void* msg, uint16_t size); //preliminary definition
+static struct RSUnicastQueueElement* rsu_enqueue(void* msg, uint16_t size, uint8_t type, uint16_t origin); //preliminary definition
+
+//The header in front of each message: seqno (1 byte), type (1 byte) and the id of the originating node (2 bytes)
+#define RSU_HEADER_SIZE 4
+//The message types. User data is passed to the callback of rsunicast_setNewMessageCallback_root.
+#define RSU_TYPE_DATA 0
+#define RSU_TYPE_TOPOLOGY 1
+//Flags in the type byte: urgent messages are always acknowledged immediately (kept on all hops), messages with
+//RSU_TYPE_BEACON_ACK are acknowledged in the next beacon of the receiver (only for this hop, see ./rsunicast_beacon_ack.h),
+//redundant messages start with an end-to-end id (kept on all hops, see ./rsunicast_multipath.h)
+#define RSU_TYPE_REDUNDANT 0x20
+#define RSU_TYPE_URGENT 0x40
+#define RSU_TYPE_BEACON_ACK 0x80
+#define RSU_TYPE_MASK 0x1f
+//The length of an ACK frame. Frames of other length on the ACK channel are discarded (shorter ones with RSUNICAST_ACK_PAYLOAD).
+#define RSU_ACK_SIZE 1
+
+#ifdef MLST_RUNTIME_CONFIG
+//Runtime values of the parameters above for host builds (see ../mlst_config.h). Initialized with the defaults.
+struct rsu_config {
+	float timeout_in_sec;
+	clock_time_t timeout_ticks; //converted when it is set, the timers are armed without floating point arithmetic
+	uint8_t max_tries;
+};
+struct rsu_config rsu_config = {TIMEOUT_IN_SEC, TIMING_TICKS(TIMEOUT_IN_SEC), MAX_TRIES};
+#undef TIMEOUT_IN_SEC
+#define TIMEOUT_IN_SEC (rsu_config.timeout_in_sec)
+#undef RSU_TIMEOUT_TICKS
+#define RSU_TIMEOUT_TICKS (rsu_config.timeout_ticks)
+#undef MAX_TRIES
+#define MAX_TRIES (rsu_config.max_tries)
 
-void rsunicast_send(void* msg, uint16_t size); //preliminary definition
+/**
+ * Sets TIMEOUT_IN_SEC or MAX_TRIES by name. Returns 1 on success and 0 if the name is unknown.
+ */
+uint8_t rsunicast_set_parameter(const char* name, float value)
+{
+	if(strcmp(name, "TIMEOUT_IN_SEC")==0) {
+		rsu_config.timeout_in_sec = value;
+		rsu_config.timeout_ticks = TIMING_TICKS(value);
+	} else if(strcmp(name, "MAX_TRIES")==0) {
+		rsu_config.max_tries = (uint8_t)value;
+	} else {
+		return 0;
+	}
+	return 1;
+}
+#endif
 
 
 //The message queue saves all the messages that have to be sent. They are sent serially to avoid collisions and 
@@ -65,8 +158,23 @@ struct RSUnicastQueueElement {
 	uint16_t size;
 	uint8_t tries;
 	struct RSUnicastQueueElement* next;
+#ifdef RSUNICAST_COUNTERS
+	clock_time_t enqueued; //for the hop latency
+#endif
+#ifdef RSUNICAST_MULTIPATH
+	uint16_t next_hop; //the neighbor the message is sent to, 0: the parent
+#endif
 };
 
+//The neighbor the element is sent to and whether it is pinned to it (a copy of a redundant message)
+#ifdef RSUNICAST_MULTIPATH
+#define RSU_NEXT_HOP(e) ((e)->next_hop != 0 ? (e)->next_hop : rsu_parent)
+#define RSU_IS_PINNED(e) ((e)->next_hop != 0)
+#else
+#define RSU_NEXT_HOP(e) rsu_parent
+#define RSU_IS_PINNED(e) 0
+#endif
+
 //**VARIABLES**
 struct unicast_conn rsu_data_channel; //channel on which the actual messages are sent
 struct unicast_conn rsu_ack_channel; //Channel on which the ACKs are sent
@@ -78,8 +186,79 @@ uint8_t rsu_is_online = 0; //1 iff the communication channels are open
 uint8_t rsu_is_allowed_to_sleep = 0; //1 iff is allowed to switch off networking if idle
 uint16_t rsu_parent = 0; //the parent in the sink tree to whom the message are sent/forwarded
 uint16_t rsu_messages_in_queue = 0;
+uint16_t rsu_messages_enqueued = 0; //own and forwarded messages that have been queued (wraps, e.g. for the load of the node)
+uint16_t rsu_messages_forwarded = 0; //messages of other nodes that have been queued (wraps)
+#ifdef RSUNICAST_ACK_PAYLOAD
+void* rsu_ack_payload = 0; //appended to every sent ACK
+uint8_t rsu_ack_payload_size = 0;
+void (*rsu_on_ack_payload_cb)(uint16_t id, void* payload, uint8_t size) = 0; //called for received ACKs with payload
+#endif
+#if defined(RSUNICAST_OPPORTUNISTIC) || defined(RSUNICAST_MULTIPATH)
+uint8_t (*rsu_candidates_cb)(uint16_t* ids, uint8_t max) = 0; //writes the candidates for the next hop, returns their number
+#endif
 //--VARIABLES--
 
+#if defined(RSUNICAST_OPPORTUNISTIC) || defined(RSUNICAST_MULTIPATH)
+//Maximal number of candidates for the next hop (of a message with RSUNICAST_OPPORTUNISTIC, copies with RSUNICAST_MULTIPATH)
+#ifndef RSU_MAX_CANDIDATES
+#define RSU_MAX_CANDIDATES 3
+#endif
+
+/**
+ * Sets the function that writes the candidates for the next hop (at most max ids, the best first) and returns their
+ * number. Only neighbors that are closer to the root may be candidates, otherwise messages could circle.
+ */
+void rsunicast_setCandidatesCallback(uint8_t (*cb)(uint16_t* ids, uint8_t max))
+{
+	rsu_candidates_cb = cb;
+}
+#endif
+
+#include "rsunicast_counters.h"
+#include "rsunicast_beacon_ack.h"
+#include "rsunicast_opportunistic.h"
+#include "rsunicast_multipath.h"
+#include "rsunicast_fair_queue.h"
+
+//forward declaration because needed for opening the channels
+static const struct unicast_callbacks rsu_msg_callbacks;
+static const struct unicast_callbacks rsu_ack_callbacks;
+#ifdef RSUNICAST_OPPORTUNISTIC
+static const struct broadcast_callbacks rsu_opp_callbacks;
+#endif
+
+//Opens the communication channels if they are closed
+static void rsu_open_channels()
+{
+	if(rsu_is_online == 0) {
+		unicast_open(&rsu_data_channel, MESSAGING_PORT, &rsu_msg_callbacks);
+		unicast_open(&rsu_ack_channel, ACKNOWLEDGEMENT_PORT, &rsu_ack_callbacks);
+#ifdef RSUNICAST_OPPORTUNISTIC
+		broadcast_open(&rsu_opp_channel, RSU_OPP_PORT, &rsu_opp_callbacks);
+#endif
+		RADIO_ENERGY_OPEN(RADIO_ENERGY_RSU_DATA);
+		RADIO_ENERGY_OPEN(RADIO_ENERGY_RSU_ACK);
+		RADIO_POWER_ACQUIRE(RADIO_POWER_RSU); //synchronous, the radio is on before the first message is sent
+		rsu_is_online = 1;
+	}
+}
+
+//Closes the communication channels if they are open
+static void rsu_close_channels()
+{
+	if(rsu_is_online != 0) {
+		unicast_close(&rsu_data_channel);
+		unicast_close(&rsu_ack_channel);
+#ifdef RSUNICAST_OPPORTUNISTIC
+		broadcast_close(&rsu_opp_channel);
+#endif
+		RADIO_ENERGY_CLOSE(RADIO_ENERGY_RSU_DATA);
+		RADIO_ENERGY_CLOSE(RADIO_ENERGY_RSU_ACK);
+		RADIO_POWER_RELEASE(RADIO_POWER_RSU);
+		rsu_is_online = 0;
+	}
+}
+
 
 
 
@@ -88,34 +267,69 @@ uint16_t rsu_messages_in_queue = 0;
 //forward declaration because needed here
 static void rsu_send_next_message(void* ctimer_data);
 
+#ifdef RSUNICAST_BEACON_ACK
+//Removes an element from the queue (the messages of a window can be acknowledged in any order)
+static void rsu_remove(struct RSUnicastQueueElement* element)
+{
+	struct RSUnicastQueueElement** e = &rsu_queue;
+	while(*e != 0 && *e != element) e = &((*e)->next);
+	if(*e == 0) return;
+	*e = element->next;
+	free(element->msg);
+	free(element);
+	rsu_messages_in_queue--;
+}
+#endif
+
 //Is called if a sent messages times out without the acknowledgement being received.
 static void rsu_on_ack_timeout(void* ctimer_data)
 {
 #ifdef DEBUG
 	printf("TIME OUT\n");
 #endif
+	TRACE_EVENT(TRACE_TIMEOUT, rsu_queue->tries, rsu_parent, 0);
 	//TODO rsu_parent
-	if(rsu_onLostMessageCB!=0) (*rsu_onLostMessageCB)(rsu_parent, rsu_queue->tries);
-
+	if(rsu_onLostMessageCB!=0) (*rsu_onLostMessageCB)(RSU_NEXT_HOP(rsu_queue), rsu_queue->tries);
+
+#ifdef RSUNICAST_BEACON_ACK
+	//all messages of the window that have been sent too often are discarded
+	struct RSUnicastQueueElement* e = rsu_queue;
+	while(e != 0){
+		struct RSUnicastQueueElement* next = e->next;
+		if(e->tries > MAX_TRIES){
+			TRACE_EVENT(TRACE_DROP, e->tries, rsu_parent, 0);
+			RSU_COUNT(dropped);
+			rsu_remove(e);
+		}
+		e = next;
+	}
+	RSU_FQ_REFILL();
+	if(rsu_queue == 0 && rsu_is_allowed_to_sleep == 1){
+		rsu_close_channels();
+	}
+#else
 	//If there has been to many failed transmission attempts
 	if(rsu_queue->tries > MAX_TRIES){
+		TRACE_EVENT(TRACE_DROP, rsu_queue->tries, rsu_parent, 0);
+		RSU_COUNT(dropped);
 		//Remove first element in queue
 		free(rsu_queue->msg);
 		struct RSUnicastQueueElement* tmp = rsu_queue;
 		rsu_queue = rsu_queue->next;
 		free(tmp);
+		rsu_messages_in_queue--;
+		RSU_FQ_REFILL();
 
 		//if is now idle and allowed to sleep, go to sleep
 		if(rsu_queue == 0 && rsu_is_allowed_to_sleep == 1){
-			unicast_close(&rsu_data_channel);
-			unicast_close(&rsu_ack_channel);
-			rsu_is_online = 0;
+			rsu_close_channels();
 		}
 	}
+#endif
 
 	if(rsu_queue!=0){
 		//Start timer for next message
-		ctimer_set(&rsu_timer, CLOCK_SECOND*DELAY_ON_FAIL_IN_SEC*((float)random_rand()/RANDOM_RAND_MAX)*(rsu_queue->tries*rsu_queue->tries),
+		ctimer_set(&rsu_timer, CONVERGECAST_ALIGN(timing_random(RSU_DELAY_ON_FAIL_TICKS*rsu_queue->tries*rsu_queue->tries)),
 				rsu_send_next_message, 0);
 	}
 }
@@ -124,64 +338,206 @@ static void rsu_on_ack_timeout(void* ctimer_data)
 //Is called if the first element of the queue should be sent
 static void rsu_send_next_message(void* ctimer_data)
 {
-	if(rsu_parent!=0){
+#ifdef MLST_CONVERGECAST
+	//a sleeping node only wakes up for its slot
+	rsu_open_channels();
+#endif
+#ifdef RSUNICAST_OPPORTUNISTIC
+	//the candidates are asked first: with an alternative to the parent, opportunistic forwarding takes precedence over
+	//the window of RSUNICAST_BEACON_ACK (with only the parent the window saves the ACK frames)
+	static uint16_t candidates[RSU_MAX_CANDIDATES];
+	uint8_t n = (rsu_parent!=0 && rsu_candidates_cb!=0 && !RSU_IS_PINNED(rsu_queue)) ?
+			(*rsu_candidates_cb)(candidates, RSU_MAX_CANDIDATES) : 0;
+	if(n > RSU_MAX_CANDIDATES || 2 + 2*n + rsu_queue->size > PACKETBUF_SIZE) n = 0;
+#endif
+#ifdef RSUNICAST_BEACON_ACK
+	//if the beacons of the parent can be heard, send a window of messages that are acknowledged in its next beacon
+	uint8_t window = rsu_parent!=0 && rsu_can_hear_beacons_cb!=0 && (*rsu_can_hear_beacons_cb)();
+#ifdef RSUNICAST_OPPORTUNISTIC
+	if(n > 1) window = 0;
+#endif
+	if(window){
+		static linkaddr_t parent;
+		parent.u8[0] = rsu_parent>>8;
+		parent.u8[1] = rsu_parent&0xFF;
+		uint8_t sent = 0;
+		struct RSUnicastQueueElement* e = rsu_queue;
+		for(; e!=0 && sent<RSU_BEACON_ACK_WINDOW && (((uint8_t*)e->msg)[1] & RSU_TYPE_URGENT)==0 && !RSU_IS_PINNED(e);
+				e=e->next, sent++){
+			packetbuf_copyfrom(e->msg, e->size);
+			((uint8_t*) packetbuf_dataptr())[1] |= RSU_TYPE_BEACON_ACK;
+			unicast_send(&rsu_data_channel, &parent);
+			RADIO_ENERGY_TX(RADIO_ENERGY_RSU_DATA, e->size);
+			e->tries++;
+			TRACE_EVENT(TRACE_TX, e->tries, rsu_parent, e->size);
+			RSU_COUNT(sent);
+			if(e->tries > 1) RSU_COUNT(retried);
+		}
+		if(sent > 0){
+			ctimer_stop(&rsu_timer);
+			ctimer_set(&rsu_timer, RSU_BEACON_ACK_TIMEOUT, rsu_on_ack_timeout, 0);
+			return;
+		}
+	}
+#endif
+#ifdef RSUNICAST_OPPORTUNISTIC
+	//broadcast the message with the candidates, the first one that takes it over answers with a claim
+	if(n > 0){
+		packetbuf_clear();
+		uint8_t* p = (uint8_t*) packetbuf_dataptr();
+		p[0] = RSU_OPP_DATA;
+		p[1] = n;
+		uint8_t i;
+		for(i=0; i<n; i++){
+			p[2+2*i] = candidates[i] & 0xff;
+			p[3+2*i] = candidates[i] >> 8;
+		}
+		memcpy(p + 2 + 2*n, rsu_queue->msg, rsu_queue->size);
+		packetbuf_set_datalen(2 + 2*n + rsu_queue->size);
+		broadcast_send(&rsu_opp_channel);
+		RADIO_ENERGY_TX(RADIO_ENERGY_RSU_DATA, packetbuf_datalen());
+		rsu_queue->tries++;
+		TRACE_EVENT(TRACE_TX, rsu_queue->tries, candidates[0], rsu_queue->size);
+		RSU_COUNT(sent);
+		if(rsu_queue->tries > 1) RSU_COUNT(retried);
+		//the last candidate claims after its slot
+		ctimer_stop(&rsu_timer);
+		ctimer_set(&rsu_timer, RSU_TIMEOUT_TICKS + (n-1)*RSU_OPP_SLOT, rsu_on_ack_timeout, 0);
+		return;
+	}
+#endif
+	uint16_t next_hop = RSU_NEXT_HOP(rsu_queue);
+	if(next_hop!=0){
 #ifdef DEBUG
 		printf("TRY TO SEND\n");
 #endif
 		packetbuf_copyfrom(rsu_queue->msg, rsu_queue->size);
 		static linkaddr_t recv;
-		recv.u8[0] = rsu_parent>>8;
-		recv.u8[1] = rsu_parent&0xFF;
+		recv.u8[0] = next_hop>>8;
+		recv.u8[1] = next_hop&0xFF;
 		unicast_send(&rsu_data_channel, &recv);
+		RADIO_ENERGY_TX(RADIO_ENERGY_RSU_DATA, rsu_queue->size);
 		rsu_queue->tries++;
+		TRACE_EVENT(TRACE_TX, rsu_queue->tries, next_hop, rsu_queue->size);
+		RSU_COUNT(sent);
+		if(rsu_queue->tries > 1) RSU_COUNT(retried);
 	}
 
 	//set timeout
 	ctimer_stop(&rsu_timer);
 	//TODO: Append rsu_parent
-	ctimer_set(&rsu_timer, CLOCK_SECOND*TIMEOUT_IN_SEC, rsu_on_ack_timeout, 0);
+	ctimer_set(&rsu_timer, RSU_TIMEOUT_TICKS, rsu_on_ack_timeout, 0);
 }
 //--CTIMER CALLBACKS--
 
 //**UNICAST CALLBACKS**
 
-/**
- * Called on new incoming message on the acknowledgment channel.
- * There cannot be any duplicate acknowledgments. It will always correspond to the top most message in the queue
- */
-void rsu_on_recieve_ack(struct unicast_conn* c, const linkaddr_t *from)
+//Removes the acknowledged first message of the queue and starts the next one
+static void rsu_on_acked()
 {
-#ifdef DEBUG
-	printf("SUCCESS\n");
-#endif
-	if(rsu_queue == 0){ printf("Received unexpected ACK\n"); return;}
+	RSU_COUNT(acked);
+	RSU_COUNT_LATENCY(rsu_queue->enqueued);
 	//Remove first element in queue
 	free(rsu_queue->msg);
 	struct RSUnicastQueueElement* tmp = rsu_queue;
 	rsu_queue = rsu_queue->next;
 	free(tmp);
 	rsu_messages_in_queue--;
+	RSU_FQ_REFILL();
 
 	//Stop timeout
 	ctimer_stop(&rsu_timer);
 	if(rsu_queue != 0){
 		//Start timer for next message
-		ctimer_set(&rsu_timer, CLOCK_SECOND*NEXT_MSG_DELAY*(0.5+(float)random_rand()/(2*RANDOM_RAND_MAX)), rsu_send_next_message, 0);
+		ctimer_set(&rsu_timer, CONVERGECAST_ALIGN(RSU_NEXT_MSG_JITTER), rsu_send_next_message, 0);
 	}
 
 	//if is idle and allowed to sleep, go to sleep
 	if(rsu_queue == 0 && rsu_is_allowed_to_sleep == 1){
-		unicast_close(&rsu_data_channel);
-		unicast_close(&rsu_ack_channel);
-		rsu_is_online = 0;
+		rsu_close_channels();
+	}
+}
+
+/**
+ * Called on new incoming message on the acknowledgment channel.
+ * There cannot be any duplicate acknowledgments. It will always correspond to the top most message in the queue
+ */
+void rsu_on_recieve_ack(struct unicast_conn* c, const linkaddr_t *from)
+{
+#ifdef DEBUG
+	printf("SUCCESS\n");
+#endif
+	RECORD_FRAME(ACKNOWLEDGEMENT_PORT, from);
+	RADIO_ENERGY_RX(RADIO_ENERGY_RSU_ACK, packetbuf_datalen());
+#ifdef RSUNICAST_ACK_PAYLOAD
+	if(packetbuf_datalen() < RSU_ACK_SIZE){ //malformed, cannot be an ACK
+#else
+	if(packetbuf_datalen() != RSU_ACK_SIZE){ //malformed, cannot be an ACK
+#endif
+		TRACE_EVENT(TRACE_MALFORMED, ACKNOWLEDGEMENT_PORT & 0xff, ((uint16_t)from->u8[0])<<8 | from->u8[1], packetbuf_datalen());
+		return;
 	}
+#ifdef RSUNICAST_ACK_PAYLOAD
+	//the payload is passed before the queue is checked, also an unexpected ACK proves that the neighbor is alive
+	if(packetbuf_datalen() > RSU_ACK_SIZE && rsu_on_ack_payload_cb != 0){
+		(*rsu_on_ack_payload_cb)(((uint16_t)from->u8[0])<<8 | from->u8[1], (uint8_t*) packetbuf_dataptr() + RSU_ACK_SIZE,
+				packetbuf_datalen() - RSU_ACK_SIZE);
+	}
+#endif
+	TRACE_EVENT(TRACE_ACK, 0, ((uint16_t)from->u8[0])<<8 | from->u8[1], 0);
+	if(rsu_queue == 0){ printf("Received unexpected ACK\n"); return;}
+	rsu_on_acked();
 }
 static const struct unicast_callbacks rsu_ack_callbacks = {rsu_on_recieve_ack};
 
+#ifdef RSUNICAST_BEACON_ACK
+/**
+ * Has to be called with the acknowledgements in a received beacon of the neighbor with the id (written by
+ * rsunicast_write_beacon_acks). Acknowledged messages are removed from the queue, the other sent ones are sent again.
+ */
+void rsunicast_on_beacon(uint16_t id, uint8_t* acks, uint8_t len)
+{
+	if(id != rsu_parent || len < 1 || len < 1 + acks[0]*RSU_BEACON_ACK_ENTRY_SIZE) return;
+	uint16_t own_id = (linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1];
+	uint8_t i;
+	for(i=0; i<acks[0]; i++){
+		uint8_t* p = acks + 1 + i*RSU_BEACON_ACK_ENTRY_SIZE;
+		if((p[0] | ((uint16_t)p[1])<<8) != own_id) continue;
+		uint8_t removed = 0;
+		struct RSUnicastQueueElement* e = rsu_queue;
+		while(e != 0){
+			struct RSUnicastQueueElement* next = e->next;
+			uint8_t behind = p[2] - ((uint8_t*)e->msg)[0];
+			if(e->tries > 0 && (((uint8_t*)e->msg)[1] & RSU_TYPE_URGENT) == 0 && behind < 8 && ((p[3] >> behind) & 1)){
+				TRACE_EVENT(TRACE_ACK, ((uint8_t*)e->msg)[0], id, 0);
+				RSU_COUNT(acked);
+				RSU_COUNT_LATENCY(e->enqueued);
+				rsu_remove(e);
+				removed++;
+			}
+			e = next;
+		}
+		if(removed == 0) return;
+		RSU_FQ_REFILL();
+		//the window is finished, send the rest (also the unacknowledged messages of the window)
+		ctimer_stop(&rsu_timer);
+		if(rsu_queue != 0){
+			ctimer_set(&rsu_timer, CONVERGECAST_ALIGN(RSU_NEXT_MSG_JITTER), rsu_send_next_message, 0);
+		} else if(rsu_is_allowed_to_sleep == 1){
+			rsu_close_channels();
+		}
+		return;
+	}
+}
+#endif
+
 
 
 #ifdef ROOT
 void (*rsu_on_new_message_for_root_cb)(void* msg, uint16_t size) = 0; //Pointer to the callback for arriving user data messages.
+void (*rsu_on_typed_message_for_root_cb)(uint8_t type, void* msg, uint16_t size) = 0; //Pointer to the callback for messages of other types.
+uint16_t rsu_current_origin = 0; //origin of the message that is currently passed to the callback
+uint16_t rsu_current_sender = 0; //last hop of the message that is currently passed to the callback
 
 /**
  * Sets the callback for the root that is called when user data messages from the other nodes arrive.
@@ -191,80 +547,318 @@ void (*rsu_on_new_message_for_root_cb)(void* msg, uint16_t size) = 0; //Pointer
 void rsunicast_setNewMessageCallback_root(void (*cb)(void* msg, uint16_t size)){
 	rsu_on_new_message_for_root_cb = cb;
 }
-#endif
 
+/**
+ * Sets the callback for the root that is called for messages that are not user data (type != RSU_TYPE_DATA), e.g. the
+ * reports of ../topology/topology_report.h. rsunicast_message_origin() and rsunicast_message_sender() can be used as well.
+ */
+void rsunicast_setTypedMessageCallback_root(void (*cb)(uint8_t type, void* msg, uint16_t size)){
+	rsu_on_typed_message_for_root_cb = cb;
+}
 
-//Called on new incoming message on the data channel
-void rsu_on_new_message(struct unicast_conn* c, const linkaddr_t *from)
-{
-	uint16_t id = ((uint16_t)from->u8[0])<<8 | from->u8[1]; //decode id
-	void* msg = packetbuf_dataptr();
-	uint16_t size = packetbuf_datalen();
-	uint8_t seqno = *(uint8_t*)msg;	
+/**
+ * Returns the id of the node that has sent the message. Only valid during the callback for new messages.
+ */
+uint16_t rsunicast_message_origin(){
+	return rsu_current_origin;
+}
 
-	//send ACK
+/**
+ * Returns the id of the neighbor from which the message has been received (the last hop). Only valid during the callback
+ * for new messages.
+ */
+uint16_t rsunicast_message_sender(){
+	return rsu_current_sender;
+}
+#endif
+
+//Sends the acknowledgement for the last received message to the neighbor with the id
+static void rsu_send_ack(uint16_t id)
+{
 	char ack = 'A';
-	packetbuf_copyfrom(&ack, 1);
+#ifdef RSUNICAST_ACK_PAYLOAD
+	packetbuf_clear();
+	((char*) packetbuf_dataptr())[0] = ack;
+	if(rsu_ack_payload != 0) memcpy((uint8_t*) packetbuf_dataptr() + RSU_ACK_SIZE, rsu_ack_payload, rsu_ack_payload_size);
+	packetbuf_set_datalen(RSU_ACK_SIZE + (rsu_ack_payload != 0 ? rsu_ack_payload_size : 0));
+#else
+	packetbuf_copyfrom(&ack, RSU_ACK_SIZE);
+#endif
 	static linkaddr_t recv;
 	recv.u8[0] = id>>8;
 	recv.u8[1] = id&0xFF;
 	unicast_send(&rsu_ack_channel, &recv);
+	RADIO_ENERGY_TX(RADIO_ENERGY_RSU_ACK, packetbuf_datalen());
+}
+
+#ifdef RSUNICAST_ACK_PAYLOAD
+/**
+ * Sets the data that is appended to every sent ACK (the memory is read when the ACK is sent, thus the current value is
+ * sent). Set 0 to send ACKs without payload.
+ */
+void rsunicast_setAckPayload(void* payload, uint8_t size)
+{
+	rsu_ack_payload = payload;
+	rsu_ack_payload_size = size;
+}
+
+/**
+ * Sets the callback that is called for every received ACK with payload, with the id of the sender.
+ */
+void rsunicast_setAckPayloadCallback(void (*cb)(uint16_t id, void* payload, uint8_t size))
+{
+	rsu_on_ack_payload_cb = cb;
+}
+#endif
+
+
+//Passes a new message (without the header) that has been received from the neighbor with the id to the root callbacks,
+//or enqueues it for forwarding
+static void rsu_deliver(uint16_t id, void* msg, uint16_t size, uint8_t type, uint16_t origin)
+{
 #ifdef ROOT
 	//Inform root about new message for it
-	if(rsu_on_new_message_for_root_cb!=0){
-		if(rsu_check_history(id, seqno)==0){ //no duplicate
-			(*rsu_on_new_message_for_root_cb)(msg+1, size-sizeof(uint8_t));
+	rsu_current_origin = origin;
+	rsu_current_sender = id;
+#ifdef RSUNICAST_MULTIPATH
+	if(type & RSU_TYPE_REDUNDANT){
+		//only the first copy of a redundant message is passed, without its end-to-end id
+		if(size < RSU_E2E_ID_SIZE || rsu_e2e_check(origin, ((uint8_t*)msg)[0])){
+			TRACE_EVENT(TRACE_DUPLICATE, size < RSU_E2E_ID_SIZE ? 0 : ((uint8_t*)msg)[0], origin, 0);
+			RSU_COUNT(duplicates);
+			return;
 		}
+		msg = (uint8_t*)msg + RSU_E2E_ID_SIZE;
+		size -= RSU_E2E_ID_SIZE;
+	}
+#endif
+	type &= RSU_TYPE_MASK;
+	if(type == RSU_TYPE_DATA){
+		if(rsu_on_new_message_for_root_cb!=0) (*rsu_on_new_message_for_root_cb)(msg, size);
+	} else if(rsu_on_typed_message_for_root_cb!=0){
+		(*rsu_on_typed_message_for_root_cb)(type, msg, size);
+	}
+#else
+	//Add to queue
+	RSU_COUNT(forwarded);
+	rsu_enqueue(msg, size, type, origin);
+#endif
+}
+
+//Called on new incoming message on the data channel
+void rsu_on_new_message(struct unicast_conn* c, const linkaddr_t *from)
+{
+	uint16_t id = ((uint16_t)from->u8[0])<<8 | from->u8[1]; //decode id
+	void* msg = packetbuf_dataptr();
+	uint16_t size = packetbuf_datalen();
+	RECORD_FRAME(MESSAGING_PORT, from);
+	RADIO_ENERGY_RX(RADIO_ENERGY_RSU_DATA, size);
+	//reject frames without a complete header before the header is read. They are not acknowledged.
+	if(size < RSU_HEADER_SIZE){
+		TRACE_EVENT(TRACE_MALFORMED, MESSAGING_PORT & 0xff, id, size);
+		return;
+	}
+	uint8_t seqno = *(uint8_t*)msg;	
+	uint8_t type = ((uint8_t*)msg)[1];
+	uint16_t origin = ((uint8_t*)msg)[2] | ((uint16_t)((uint8_t*)msg)[3])<<8;
+	TRACE_EVENT(TRACE_RX, seqno, id, size);
+#if defined(RSUNICAST_FAIR_QUEUE) && !defined(ROOT)
+	//the queue of the source is full: no ACK, the child retries later
+	if(rsu_fq_is_full(origin)){
+		RSU_COUNT(refused);
+		return;
 	}
+#endif
+#ifdef RSUNICAST_BEACON_ACK
+	uint8_t beacon_ack = type & RSU_TYPE_BEACON_ACK; //acknowledged in the next beacon instead of an ACK frame
+	type &= ~RSU_TYPE_BEACON_ACK;
+	//the child may resend a message of a window without the flag (its PVN went offline) and vice versa
+	uint8_t duplicate = rsu_beacon_ack_record(id, seqno, beacon_ack) || rsu_check_history(id, seqno);
 #else
-	//Check for duplicate
-	if(rsu_check_history(id, seqno)!=0){
+	uint8_t duplicate = rsu_check_history(id, seqno);
+#endif
+
+	//The message is handled before the ACK is sent as the ACK overwrites the packetbuf
+	if(duplicate!=0){
 #ifdef DEBUG
 		printf("Received duplicate message from %d\n",id);
 #endif
-		//Duplicate
-		return;
+		TRACE_EVENT(TRACE_DUPLICATE, seqno, id, 0);
+		RSU_COUNT(duplicates);
+		//Duplicate (the ACK has been lost), only acknowledge again
 	} else {
 #ifdef DEBUG
 		printf("Received message from %d\n",id);
 #endif
 		//Add to history
 		rsu_add_history(id, seqno);
-		//Add to queue
-		rsunicast_send(msg+1, size-sizeof(uint8_t));
+		rsu_deliver(id, msg+RSU_HEADER_SIZE, size-RSU_HEADER_SIZE, type, origin);
+	}
+
+	//send ACK
+#ifdef RSUNICAST_BEACON_ACK
+	if(beacon_ack != 0){
+		if(rsu_request_beacon_cb != 0) (*rsu_request_beacon_cb)();
+		return;
 	}
 #endif
+	rsu_send_ack(id);
 }
 static const struct unicast_callbacks rsu_msg_callbacks = {rsu_on_new_message};
+
+#ifdef RSUNICAST_OPPORTUNISTIC
+//Broadcasts the claim of the message with the seqno of the sender (this node forwards it)
+static void rsu_opp_send_claim(uint16_t sender, uint8_t seqno)
+{
+	packetbuf_clear();
+	uint8_t* p = (uint8_t*) packetbuf_dataptr();
+	p[0] = RSU_OPP_CLAIM;
+	p[1] = sender & 0xff;
+	p[2] = sender >> 8;
+	p[3] = seqno;
+	packetbuf_set_datalen(RSU_OPP_CLAIM_SIZE);
+	broadcast_send(&rsu_opp_channel);
+	RADIO_ENERGY_TX(RADIO_ENERGY_RSU_ACK, RSU_OPP_CLAIM_SIZE);
+}
+
+//Takes over a message whose slot has come without a claim of a better candidate
+static void rsu_opp_on_slot(void* ptr)
+{
+	struct rsu_opp_pending* p = (struct rsu_opp_pending*) ptr;
+	rsu_add_history(p->sender, p->seqno);
+	rsu_deliver(p->sender, p->msg, p->size, p->type, p->origin);
+	rsu_opp_send_claim(p->sender, p->seqno);
+	rsu_opp_release(p);
+}
+
+//Called for messages with candidates and for claims
+void rsu_on_opportunistic(struct broadcast_conn* c, const linkaddr_t *from)
+{
+	uint16_t id = ((uint16_t)from->u8[0])<<8 | from->u8[1];
+	uint8_t* data = (uint8_t*) packetbuf_dataptr();
+	uint16_t size = packetbuf_datalen();
+	uint16_t own_id = (linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1];
+	RECORD_FRAME(RSU_OPP_PORT, from);
+	RADIO_ENERGY_RX(RADIO_ENERGY_RSU_DATA, size);
+	if(size == RSU_OPP_CLAIM_SIZE && data[0] == RSU_OPP_CLAIM){
+		uint16_t sender = data[1] | ((uint16_t)data[2])<<8;
+		uint8_t seqno = data[3];
+		if(sender == own_id){
+			//the ACK of the own message (only the first claim counts)
+			TRACE_EVENT(TRACE_ACK, seqno, id, 0);
+			if(rsu_queue != 0 && rsu_queue->tries > 0 && ((uint8_t*)rsu_queue->msg)[0] == seqno) rsu_on_acked();
+		} else {
+			//another candidate forwards the message
+			TRACE_EVENT(TRACE_SUPPRESS, seqno, id, 0);
+			rsu_opp_suppress(sender, seqno);
+		}
+		return;
+	}
+	//reject frames without the complete list of candidates and header
+	if(size < 2 || data[0] != RSU_OPP_DATA || size < 2 + 2*data[1] + RSU_HEADER_SIZE){
+		TRACE_EVENT(TRACE_MALFORMED, RSU_OPP_PORT & 0xff, id, size);
+		return;
+	}
+	uint8_t n = data[1], position;
+	for(position=0; position<n && (data[2+2*position] | ((uint16_t)data[3+2*position])<<8) != own_id; position++) {}
+	if(position == n) return; //not a candidate
+	uint8_t* msg = data + 2 + 2*n;
+	size -= 2 + 2*n;
+	uint8_t seqno = msg[0];
+	uint8_t type = msg[1];
+	uint16_t origin = msg[2] | ((uint16_t)msg[3])<<8;
+	TRACE_EVENT(TRACE_RX, seqno, id, size);
+	if(rsu_check_history(id, seqno)){
+		//already taken over, the claim has been lost
+		TRACE_EVENT(TRACE_DUPLICATE, seqno, id, 0);
+		RSU_COUNT(duplicates);
+		rsu_opp_send_claim(id, seqno);
+		return;
+	}
+	if(rsu_opp_is_suppressed(id, seqno) || rsu_opp_find(id, seqno) != 0) return;
+#if defined(RSUNICAST_FAIR_QUEUE) && !defined(ROOT)
+	//the queue of the source is full: leave the message to the other candidates
+	if(rsu_fq_is_full(origin)){
+		RSU_COUNT(refused);
+		return;
+	}
+#endif
+	TRACE_EVENT(TRACE_CLAIM, seqno, id, position);
+	if(position == 0){
+		//the best candidate takes the message over immediately (handled before the claim overwrites the packetbuf)
+		rsu_add_history(id, seqno);
+		rsu_deliver(id, msg + RSU_HEADER_SIZE, size - RSU_HEADER_SIZE, type, origin);
+		rsu_opp_send_claim(id, seqno);
+		return;
+	}
+	//wait for the slot, a better candidate may claim it before
+	struct rsu_opp_pending* p = 0;
+	uint8_t i;
+	for(i=0; i<RSU_OPP_PENDING && p == 0; i++) if(rsu_opp_pending[i].sender == 0) p = &rsu_opp_pending[i];
+	if(p == 0) return; //no space, the better candidates or a retry have to deliver it
+	p->msg = malloc(size - RSU_HEADER_SIZE + 1);
+	CHECK_ALLOCATION( p->msg );
+	if(p->msg == 0) return;
+	memcpy(p->msg, msg + RSU_HEADER_SIZE, size - RSU_HEADER_SIZE);
+	p->size = size - RSU_HEADER_SIZE;
+	p->sender = id;
+	p->seqno = seqno;
+	p->type = type;
+	p->origin = origin;
+	ctimer_set(&p->timer, position*RSU_OPP_SLOT, rsu_opp_on_slot, p);
+}
+static const struct broadcast_callbacks rsu_opp_callbacks = {rsu_on_opportunistic};
+#endif
 //--UNICAST CALLBACKS--
 
 
 /**
- * Sends data of this node to the parent. If there are still outstanding message, it is appended to the end of the message 
- * queue.
- * @param msg The data to be sent. Will be copied, so you can free the memory afterwards
- * @param size The size of msg
+ * Appends a message with the given type and origin to the message queue. Used for own and forwarded messages.
+ * Returns the new element of the queue, 0 if the message is discarded (RSUNICAST_FAIR_QUEUE: the queue of the origin is full).
  */
-void rsunicast_send(void* msg, uint16_t size)
+static struct RSUnicastQueueElement* rsu_enqueue(void* msg, uint16_t size, uint8_t type, uint16_t origin)
 {
-	//if is sleeping, wake up
-	if(rsu_is_online == 0) {
-		unicast_open(&rsu_data_channel, MESSAGING_PORT, &rsu_msg_callbacks);
-		unicast_open(&rsu_ack_channel, ACKNOWLEDGEMENT_PORT, &rsu_ack_callbacks);
-		rsu_is_online = 1;
+#ifdef RSUNICAST_FAIR_QUEUE
+	if(rsu_fq_is_full(origin)){
+		RSU_COUNT(refused);
+		return 0;
 	}
+#endif
+	rsu_messages_enqueued++;
+	if(origin != ((linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1])) rsu_messages_forwarded++;
+#ifndef MLST_CONVERGECAST
+	//if is sleeping, wake up
+	rsu_open_channels();
+#endif
 
 	//Create Queue Entry
 	struct RSUnicastQueueElement* queue_element = (struct RSUnicastQueueElement*) calloc(1, sizeof(struct RSUnicastQueueElement));
 	CHECK_ALLOCATION( queue_element );
-	queue_element->size = size + sizeof(uint8_t);
+	queue_element->size = size + RSU_HEADER_SIZE;
 	queue_element->msg = calloc(1, queue_element->size);
 	CHECK_ALLOCATION( queue_element->msg );
-	//set seqno
-	*((uint8_t*)(queue_element->msg)) = rsu_seqno;
-	memcpy(queue_element->msg+1, msg, size);
+	//set header
+	((uint8_t*)(queue_element->msg))[0] = rsu_seqno;
+	((uint8_t*)(queue_element->msg))[1] = type;
+	((uint8_t*)(queue_element->msg))[2] = origin & 0xff;
+	((uint8_t*)(queue_element->msg))[3] = origin >> 8;
+	memcpy(queue_element->msg+RSU_HEADER_SIZE, msg, size);
 	queue_element->tries = 0;
+#ifdef RSUNICAST_COUNTERS
+	queue_element->enqueued = clock_time();
+#endif
 
+#ifdef RSUNICAST_FAIR_QUEUE
+	//to the virtual queue of the origin, the seqno is set when it is moved to rsu_queue
+	rsu_fq_add(queue_element, origin);
+	rsu_messages_in_queue++;
+	RSU_COUNT_QUEUE_LENGTH(rsu_messages_in_queue);
+	if(rsu_queue==0) {
+		rsu_fq_refill();
+		ctimer_set(&rsu_timer, CONVERGECAST_ALIGN(RSU_FIRST_SEND_DELAY(origin)), rsu_send_next_message, 0);
+	}
+	return queue_element;
+#else
 	//increment sequence no
 	if(rsu_seqno == 0xff) rsu_seqno = 0;
 	else rsu_seqno++;
@@ -273,7 +867,8 @@ void rsunicast_send(void* msg, uint16_t size)
 	//Add to queue
 	if(rsu_queue==0) {
 		rsu_queue = queue_element;
-		ctimer_set(&rsu_timer, CLOCK_SECOND*NEXT_MSG_DELAY*(0.5+(float)random_rand()/(2*RANDOM_RAND_MAX)), rsu_send_next_message, 0); //bump sending if idle
+		//bump sending if idle (shares the wake-up of the MLST if close to it, with MLST_CONVERGECAST in the own slot)
+		ctimer_set(&rsu_timer, CONVERGECAST_ALIGN(RSU_FIRST_SEND_DELAY(origin)), rsu_send_next_message, 0);
 	} else {
 		//append at end
 		struct RSUnicastQueueElement* tmp = rsu_queue;
@@ -281,6 +876,77 @@ void rsunicast_send(void* msg, uint16_t size)
 		tmp->next = queue_element;
 	}	
 	rsu_messages_in_queue++;
+	RSU_COUNT_QUEUE_LENGTH(rsu_messages_in_queue);
+	return queue_element;
+#endif
+}
+
+/**
+ * Sends data of this node to the parent. If there are still outstanding message, it is appended to the end of the message 
+ * queue.
+ * @param msg The data to be sent. Will be copied, so you can free the memory afterwards
+ * @param size The size of msg
+ * @return 1 if the message has been queued, 0 if it is discarded (RSUNICAST_FAIR_QUEUE: too many own messages are waiting)
+ */
+uint8_t rsunicast_send(void* msg, uint16_t size)
+{
+	return rsu_enqueue(msg, size, RSU_TYPE_DATA, (linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1]) != 0;
+}
+
+#ifdef RSUNICAST_BEACON_ACK
+/**
+ * Like rsunicast_send, but the message is acknowledged immediately by an ACK frame on every hop (not in the beacon).
+ * Returns 1 if the message has been queued, 0 if it is discarded.
+ */
+uint8_t rsunicast_send_urgent(void* msg, uint16_t size)
+{
+	return rsu_enqueue(msg, size, RSU_TYPE_DATA | RSU_TYPE_URGENT, (linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1]) != 0;
+}
+#endif
+
+#ifdef RSUNICAST_MULTIPATH
+/**
+ * Sends copies of a message to up to copies different first hops (the candidates of rsunicast_setCandidatesCallback,
+ * the parent first). All copies carry the same end-to-end id, the root passes only the first one that arrives.
+ * Without candidates a single copy is sent to the parent. Returns the number of queued copies, 0 if none has been queued
+ * (e.g. RSUNICAST_FAIR_QUEUE: too many own messages are waiting).
+ */
+uint8_t rsunicast_send_redundant(void* msg, uint16_t size, uint8_t copies)
+{
+	static uint16_t hops[RSU_MAX_CANDIDATES];
+	uint16_t own_id = (linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1];
+	uint8_t n = 0, i, queued = 0;
+	if(copies > RSU_MAX_CANDIDATES) copies = RSU_MAX_CANDIDATES;
+	if(copies > 0 && rsu_parent != 0 && rsu_candidates_cb != 0) n = (*rsu_candidates_cb)(hops, copies);
+	if(n > copies) n = copies;
+	//the end-to-end id in front of the message
+	uint8_t* copy = (uint8_t*) malloc(size + RSU_E2E_ID_SIZE);
+	CHECK_ALLOCATION( copy );
+	if(copy == 0) return 0;
+	copy[0] = rsu_e2e_seqno++;
+	memcpy(copy + RSU_E2E_ID_SIZE, msg, size);
+	if(n == 0){
+		queued = rsu_enqueue(copy, size + RSU_E2E_ID_SIZE, RSU_TYPE_DATA | RSU_TYPE_REDUNDANT, own_id) != 0;
+	} else {
+		for(i=0; i<n; i++){
+			struct RSUnicastQueueElement* e = rsu_enqueue(copy, size + RSU_E2E_ID_SIZE, RSU_TYPE_DATA | RSU_TYPE_REDUNDANT, own_id);
+			if(e == 0) continue; //RSUNICAST_FAIR_QUEUE: too many own messages are waiting
+			e->next_hop = hops[i];
+			queued++;
+		}
+	}
+	free(copy);
+	return queued;
+}
+#endif
+
+/**
+ * Like rsunicast_send but for messages of internal services. At the root they are passed to the callback of
+ * rsunicast_setTypedMessageCallback_root instead of the one for user data.
+ */
+void rsunicast_send_typed(uint8_t type, void* msg, uint16_t size)
+{
+	rsu_enqueue(msg, size, type, (linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1]);
 }
 
 
@@ -294,9 +960,7 @@ void rsunicast_init()
 {
 	static uint8_t is_initialized = 0;
 	if(is_initialized==0) {
-		unicast_open(&rsu_data_channel, MESSAGING_PORT, &rsu_msg_callbacks);
-		unicast_open(&rsu_ack_channel, ACKNOWLEDGEMENT_PORT, &rsu_ack_callbacks);
-		rsu_is_online = 1;
+		rsu_open_channels();
 		is_initialized = 1;
 	}
 }
@@ -309,9 +973,7 @@ void rsunicast_allowSleeping()
 	rsu_is_allowed_to_sleep = 1;
 	//if is idle, set to sleep
 	if(rsu_queue == 0) {
-		unicast_close(&rsu_data_channel);
-		unicast_close(&rsu_ack_channel);
-		rsu_is_online = 0;
+		rsu_close_channels();
 	}
 }
 
@@ -323,11 +985,7 @@ void rsunicast_disallowSleeping()
 {
 	rsu_is_allowed_to_sleep = 0;
 	//if is sleeping, wake up
-	if(rsu_is_online == 0) {
-		unicast_open(&rsu_data_channel, MESSAGING_PORT, &rsu_msg_callbacks);
-		unicast_open(&rsu_ack_channel, ACKNOWLEDGEMENT_PORT, &rsu_ack_callbacks);
-		rsu_is_online = 1;
-	}
+	rsu_open_channels();
 }
 
 /**
@@ -358,5 +1016,8 @@ void rsunicast_print_state()
 	} else {
 		printf(", online\n");
 	}
+#ifdef RSUNICAST_COUNTERS
+	rsunicast_counters_print();
+#endif
 }
 #endif
@@ -0,0 +1,148 @@
+/**
+ * MODULE OF rsunicast.h (included by it after its variables)
+ *
+ * Acknowledgements in the beacons of the parent instead of ACK frames (`#define RSUNICAST_BEACON_ACK`).
+ *
+ * A child that can hear the beacons of its parent (its PVN is online) sends a window of up to RSU_BEACON_ACK_WINDOW
+ * messages with the flag RSU_TYPE_BEACON_ACK in the type byte. The parent does not answer each of them with an ACK frame
+ * but records them per child (the last seqno and a bitmap of the 8 seqnos up to it) and requests an expedited beacon
+ * (within RSU_BEACON_ACK_DELAY). The table is appended to the beacon (see pvn_set_appendix), every entry is repeated in
+ * RSU_BEACON_ACK_REPEAT beacons, thus a single lost beacon does not cause retransmissions.
+ * The child removes all acknowledged messages from its queue and sends the remaining ones again.
+ * Messages sent with rsunicast_send_urgent (RSU_TYPE_URGENT, kept on all hops) and messages of children whose PVN is
+ * offline are acknowledged immediately as before.
+ *
+ * The appendix: number of entries (1 byte), then per entry the id of the child (2 bytes, little endian), the last seqno
+ * and the bitmap (bit d: seqno last-d has been received).
+ * The table also detects duplicates of these messages, as the history only keeps the last seqno. A message of a window
+ * whose acknowledgement has been lost may be sent again without the flag (the PVN of the child went offline) and a message
+ * acknowledged immediately may be sent again with the flag, thus every message is checked against the table and the
+ * history and recorded in both (see rsu_on_new_message).
+ * With RSUNICAST_OPPORTUNISTIC the window is only used if the parent is the only candidate, otherwise the message is
+ * forwarded opportunistically (see rsu_send_next_message).
+ * All nodes have to use the same setting.
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef RSUNICAST_BEACON_ACK_H
+#define RSUNICAST_BEACON_ACK_H
+
+#include "contiki.h"
+
+#ifdef RSUNICAST_BEACON_ACK
+
+//Number of children whose messages can be acknowledged in one beacon
+#ifndef RSU_BEACON_ACK_CHILDREN
+#define RSU_BEACON_ACK_CHILDREN 8
+#endif
+//Number of beacons in which an entry is repeated
+#ifndef RSU_BEACON_ACK_REPEAT
+#define RSU_BEACON_ACK_REPEAT 2
+#endif
+//Maximal delay of the expedited beacon after a message has been received
+#ifndef RSU_BEACON_ACK_DELAY
+#define RSU_BEACON_ACK_DELAY (CLOCK_SECOND/8)
+#endif
+//Time the child waits for the beacon with the acknowledgements
+#ifndef RSU_BEACON_ACK_TIMEOUT
+#define RSU_BEACON_ACK_TIMEOUT (CLOCK_SECOND/2)
+#endif
+//Maximal number of messages that are sent without acknowledgement (at most 8, the size of the bitmap)
+#ifndef RSU_BEACON_ACK_WINDOW
+#define RSU_BEACON_ACK_WINDOW 4
+#endif
+
+#define RSU_BEACON_ACK_ENTRY_SIZE 4
+
+struct rsu_beacon_ack_entry {
+	uint16_t id; //0: unused
+	uint8_t last; //last (highest) seqno received
+	uint8_t bitmap; //bit d: seqno last-d has been received
+	uint8_t repeat; //number of beacons in which the entry is still sent
+};
+
+//**VARIABLES**
+struct rsu_beacon_ack_entry rsu_beacon_acks[RSU_BEACON_ACK_CHILDREN];
+uint8_t rsu_beacon_ack_replace = 0; //next entry that is replaced if the table is full (round robin)
+uint8_t (*rsu_can_hear_beacons_cb)() = 0; //1 iff the beacons of the parent are received
+void (*rsu_request_beacon_cb)() = 0; //requests an expedited beacon
+//--VARIABLES--
+
+/**
+ * Records a received message of a child. Returns 1 iff it is a duplicate. A message without the flag (acknowledge=0) is
+ * only recorded if the child has an entry, it keeps the bitmap in step with the seqnos but is not acknowledged in a beacon.
+ */
+static uint8_t rsu_beacon_ack_record(uint16_t id, uint8_t seqno, uint8_t acknowledge)
+{
+	struct rsu_beacon_ack_entry* e = 0;
+	uint8_t i;
+	for(i=0; i<RSU_BEACON_ACK_CHILDREN; i++) {
+		if(rsu_beacon_acks[i].id == id) { e = &rsu_beacon_acks[i]; break; }
+	}
+	if(e == 0) {
+		if(!acknowledge) return 0;
+		for(i=0; i<RSU_BEACON_ACK_CHILDREN && rsu_beacon_acks[i].id != 0; i++) {}
+		if(i == RSU_BEACON_ACK_CHILDREN) {
+			i = rsu_beacon_ack_replace;
+			rsu_beacon_ack_replace = (rsu_beacon_ack_replace+1)%RSU_BEACON_ACK_CHILDREN;
+		}
+		e = &rsu_beacon_acks[i];
+		e->id = id;
+		e->last = seqno;
+		e->bitmap = 1;
+		e->repeat = RSU_BEACON_ACK_REPEAT;
+		return 0;
+	}
+	if(acknowledge) e->repeat = RSU_BEACON_ACK_REPEAT;
+	uint8_t behind = e->last - seqno;
+	if(behind < 8) { //within the bitmap
+		uint8_t duplicate = (e->bitmap >> behind) & 1;
+		e->bitmap |= 1 << behind;
+		return duplicate;
+	}
+	uint8_t ahead = seqno - e->last;
+	//newer message, or one far behind (e.g. the child has been restarted): start again from it
+	e->bitmap = (ahead < 8) ? (e->bitmap << ahead) | 1 : 1;
+	e->last = seqno;
+	return 0;
+}
+
+/**
+ * Writes the acknowledgements of the recently received messages into buf (the appendix of the beacon). Returns the
+ * number of written bytes, 0 if there is nothing to acknowledge.
+ */
+uint8_t rsunicast_write_beacon_acks(uint8_t* buf, uint8_t max)
+{
+	uint8_t n = 0, i;
+	for(i=0; i<RSU_BEACON_ACK_CHILDREN; i++) {
+		struct rsu_beacon_ack_entry* e = &rsu_beacon_acks[i];
+		if(e->repeat == 0 || 1+(n+1)*RSU_BEACON_ACK_ENTRY_SIZE > max) continue;
+		uint8_t* p = buf + 1 + n*RSU_BEACON_ACK_ENTRY_SIZE;
+		p[0] = e->id & 0xff;
+		p[1] = e->id >> 8;
+		p[2] = e->last;
+		p[3] = e->bitmap;
+		e->repeat--;
+		n++;
+	}
+	if(n == 0) return 0;
+	buf[0] = n;
+	return 1 + n*RSU_BEACON_ACK_ENTRY_SIZE;
+}
+
+/**
+ * Sets the callbacks to the neighborhood: whether the beacons of the parent can be heard (otherwise the messages are
+ * acknowledged immediately) and how an expedited beacon is requested.
+ */
+void rsunicast_setBeaconAckCallbacks(uint8_t (*can_hear_beacons)(), void (*request_beacon)())
+{
+	rsu_can_hear_beacons_cb = can_hear_beacons;
+	rsu_request_beacon_cb = request_beacon;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * MODULE OF rsunicast.h (included by it after its variables)
+ *
+ * Performance counters of rsunicast: sent frames, retries, ACKs, drops after MAX_TRIES, suppressed duplicates, forwarded
+ * messages, refused messages (RSUNICAST_FAIR_QUEUE), the high-water mark of the queue and the hop latency (from enqueueing a message until its ACK).
+ *
+ * The counters are only compiled in if `RSUNICAST_COUNTERS` is defined. Otherwise the RSU_COUNT hooks are empty.
+ * An increment is a single addition on a global struct. The counters are 16 bit and wrap around, the difference of two
+ * snapshots is still correct as long as less than 65536 events happened in between.
+ * The latencies are collected in a histogram with two buckets per power of two (in ms), thus the 95th percentile is
+ * an upper bound that is at most 50% above the real value.
+ *
+ * User Functions:
+ * ---------------------------
+ * void rsunicast_counters_snapshot(struct rsu_counters* c); //Copies the current values
+ * void rsunicast_counters_reset(); //Sets all counters to zero (the high-water mark to the current queue length)
+ * uint16_t rsunicast_counters_mean_latency_ms(const struct rsu_counters* c); //Mean hop latency of a snapshot
+ * uint16_t rsunicast_counters_p95_latency_ms(const struct rsu_counters* c); //95th percentile of the hop latency of a snapshot
+ * void rsunicast_counters_print(); //Prints the current values
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef RSUNICAST_COUNTERS_H
+#define RSUNICAST_COUNTERS_H
+
+#include "contiki.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef RSUNICAST_COUNTERS
+
+//Number of buckets of the latency histogram. Bucket 2*b+h (b>=1) holds latencies in [2^b+h*2^(b-1), 2^b+(h+1)*2^(b-1)) ms.
+#define RSU_LATENCY_BUCKETS 32
+
+struct rsu_counters {
+	uint16_t sent; //data frames transmitted (including retries)
+	uint16_t retried; //data frames that have been retransmissions
+	uint16_t acked; //messages acknowledged by the parent
+	uint16_t dropped; //messages discarded after MAX_TRIES
+	uint16_t duplicates; //received messages suppressed by the history
+	uint16_t forwarded; //messages of other nodes that have been enqueued for forwarding
+	uint16_t refused; //messages not accepted as the queue of their source was full (RSUNICAST_FAIR_QUEUE)
+	uint16_t queue_high_water; //maximal number of messages in the queue
+	uint16_t latency_count; //number of latencies in the histogram (=acked unless reset in between)
+	uint32_t latency_sum_ms;
+	uint16_t latency_histogram[RSU_LATENCY_BUCKETS];
+};
+
+//**VARIABLES**
+struct rsu_counters rsu_counters;
+//--VARIABLES--
+
+//Returns the bucket of a latency
+static uint8_t rsu_latency_bucket(uint16_t ms)
+{
+	uint8_t b = 15;
+	if(ms < 2) return ms;
+	while((ms >> b) == 0) b--;
+	return 2*b + ((ms >> (b-1)) & 1);
+}
+
+//Returns the smallest latency of the bucket (for RSU_LATENCY_BUCKETS the upper bound of the last one)
+static uint32_t rsu_latency_bucket_start(uint8_t i)
+{
+	if(i < 2) return i;
+	return (1UL << (i/2)) + (i%2)*(1UL << (i/2-1));
+}
+
+/**
+ * Adds the latency of a message that has been enqueued at the given time and is acknowledged now.
+ */
+void rsu_counters_add_latency(clock_time_t enqueued)
+{
+	uint32_t ms = (uint32_t)(clock_time() - enqueued)*1000/CLOCK_SECOND;
+	if(ms > 0xffff) ms = 0xffff;
+	rsu_counters.latency_count++;
+	rsu_counters.latency_sum_ms += ms;
+	rsu_counters.latency_histogram[rsu_latency_bucket(ms)]++;
+}
+
+/**
+ * Updates the high-water mark of the queue.
+ */
+void rsu_counters_queue_length(uint16_t n)
+{
+	if(n > rsu_counters.queue_high_water) rsu_counters.queue_high_water = n;
+}
+
+/**
+ * Copies the current values of the counters.
+ */
+void rsunicast_counters_snapshot(struct rsu_counters* c)
+{
+	memcpy(c, &rsu_counters, sizeof(struct rsu_counters));
+}
+
+/**
+ * Sets all counters to zero. The high-water mark is set to the current length of the queue.
+ */
+void rsunicast_counters_reset()
+{
+	memset(&rsu_counters, 0, sizeof(struct rsu_counters));
+	rsu_counters.queue_high_water = rsu_messages_in_queue;
+}
+
+/**
+ * Returns the mean hop latency in ms of a snapshot (0 if there is none).
+ */
+uint16_t rsunicast_counters_mean_latency_ms(const struct rsu_counters* c)
+{
+	if(c->latency_count == 0) return 0;
+	return c->latency_sum_ms/c->latency_count;
+}
+
+/**
+ * Returns an upper bound of the 95th percentile of the hop latency in ms of a snapshot (0 if there is none).
+ */
+uint16_t rsunicast_counters_p95_latency_ms(const struct rsu_counters* c)
+{
+	uint32_t rank = ((uint32_t)c->latency_count*95+99)/100; //number of latencies that have to be below the percentile
+	uint32_t seen = 0;
+	uint8_t i;
+	if(c->latency_count == 0) return 0;
+	for(i=0; i<RSU_LATENCY_BUCKETS; i++) {
+		seen += c->latency_histogram[i];
+		if(seen >= rank) break;
+	}
+	if(i >= RSU_LATENCY_BUCKETS-1) return 0xffff;
+	return rsu_latency_bucket_start(i+1)-1;
+}
+
+/**
+ * Prints the current values to the serial port.
+ */
+void rsunicast_counters_print()
+{
+	printf("RSU_COUNTERS[sent=%u, retried=%u, acked=%u, dropped=%u, duplicates=%u, forwarded=%u, refused=%u, queue_max=%u, latency_mean=%ums, latency_p95=%ums]\n",
+			rsu_counters.sent, rsu_counters.retried, rsu_counters.acked, rsu_counters.dropped, rsu_counters.duplicates,
+			rsu_counters.forwarded, rsu_counters.refused, rsu_counters.queue_high_water, rsunicast_counters_mean_latency_ms(&rsu_counters),
+			rsunicast_counters_p95_latency_ms(&rsu_counters));
+}
+
+#define RSU_COUNT(field) rsu_counters.field++
+#define RSU_COUNT_LATENCY(enqueued) rsu_counters_add_latency(enqueued)
+#define RSU_COUNT_QUEUE_LENGTH(n) rsu_counters_queue_length(n)
+#else
+#define RSU_COUNT(field)
+#define RSU_COUNT_LATENCY(enqueued)
+#define RSU_COUNT_QUEUE_LENGTH(n)
+#endif
+
+#endif
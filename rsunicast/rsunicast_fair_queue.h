@@ -0,0 +1,171 @@
+/**
+ * MODULE OF rsunicast.h (included by it after its variables)
+ *
+ * Fair queuing per source (`#define RSUNICAST_FAIR_QUEUE`). Without it all messages share one FIFO queue, thus a single
+ * chatty node can fill the queue of its parent and delay the messages of its siblings.
+ *
+ * The messages are kept in one virtual queue per origin (RSU_FQ_FLOWS queues, sources beyond share a queue by their id
+ * until their messages in it are sent).
+ * The queue rsu_queue only holds the messages that are sent right now (one, or a window with RSUNICAST_BEACON_ACK), it is
+ * refilled by deficit round-robin: every non-empty virtual queue gets RSU_FQ_QUANTUM bytes per round, thus every source
+ * gets the same share of the uplink independent of the size of its messages. The seqno of the hop is assigned when a
+ * message is moved to rsu_queue, so the receiver sees increasing seqnos.
+ * A virtual queue holds at most RSU_FQ_MAX_PER_SOURCE messages. Further messages of this source are not acknowledged
+ * (the child retries later) and own messages are discarded, thus a misbehaving node cannot exhaust the memory.
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef RSUNICAST_FAIR_QUEUE_H
+#define RSUNICAST_FAIR_QUEUE_H
+
+#include "contiki.h"
+
+#ifdef RSUNICAST_FAIR_QUEUE
+
+//Number of virtual queues
+#ifndef RSU_FQ_FLOWS
+#define RSU_FQ_FLOWS 8
+#endif
+//Bytes a virtual queue may send per round (deficit round-robin)
+#ifndef RSU_FQ_QUANTUM
+#define RSU_FQ_QUANTUM 64
+#endif
+//Maximal number of waiting messages per virtual queue
+#ifndef RSU_FQ_MAX_PER_SOURCE
+#define RSU_FQ_MAX_PER_SOURCE 8
+#endif
+//Number of messages in rsu_queue (the window that is sent without waiting for ACKs)
+#ifdef RSUNICAST_BEACON_ACK
+#define RSU_FQ_SERVICE RSU_BEACON_ACK_WINDOW
+#else
+#define RSU_FQ_SERVICE 1
+#endif
+
+struct rsu_fq_flow {
+	uint16_t source; //origin of the messages, 0: unused
+	uint8_t length;
+	uint8_t guests; //waiting messages of other sources (they share this queue as all queues were used)
+	uint16_t deficit; //bytes that may still be sent in this round
+	struct RSUnicastQueueElement* head;
+	struct RSUnicastQueueElement* tail;
+};
+
+//**VARIABLES**
+struct rsu_fq_flow rsu_fq_flows[RSU_FQ_FLOWS];
+uint8_t rsu_fq_current = 0; //virtual queue that is served (round-robin)
+uint16_t rsu_fq_waiting = 0; //number of messages in the virtual queues
+//--VARIABLES--
+
+//The origin in the header of a queued message
+#define RSU_FQ_ORIGIN(e) (((uint8_t*)(e)->msg)[2] | ((uint16_t)((uint8_t*)(e)->msg)[3])<<8)
+
+//Returns 1 iff a message of the source waits in the virtual queue
+static uint8_t rsu_fq_holds(struct rsu_fq_flow* f, uint16_t source)
+{
+	struct RSUnicastQueueElement* e = f->head;
+	uint8_t i;
+	for(i=0; i<f->length; i++, e=e->next) {
+		if(RSU_FQ_ORIGIN(e) == source) return 1;
+	}
+	return 0;
+}
+
+//Returns the virtual queue of the source (a free one if it has none, a shared one if all are used). A source keeps a
+//shared queue until its messages there are sent, otherwise they would be overtaken by its later ones.
+static struct rsu_fq_flow* rsu_fq_flow(uint16_t source)
+{
+	struct rsu_fq_flow* free_flow = 0;
+	uint8_t i, shared = 0;
+	for(i=0; i<RSU_FQ_FLOWS; i++) {
+		if(rsu_fq_flows[i].source == source && rsu_fq_flows[i].length > 0) return &rsu_fq_flows[i];
+		if(rsu_fq_flows[i].guests > 0) shared = 1;
+		if(free_flow == 0 && rsu_fq_flows[i].length == 0) free_flow = &rsu_fq_flows[i];
+	}
+	for(i=0; shared && i<RSU_FQ_FLOWS; i++) {
+		if(rsu_fq_flows[i].guests > 0 && rsu_fq_holds(&rsu_fq_flows[i], source)) return &rsu_fq_flows[i];
+	}
+	if(free_flow != 0) return free_flow;
+	return &rsu_fq_flows[source % RSU_FQ_FLOWS];
+}
+
+/**
+ * Returns 1 iff the virtual queue of the source is full.
+ */
+uint8_t rsu_fq_is_full(uint16_t source)
+{
+	return rsu_fq_flow(source)->length >= RSU_FQ_MAX_PER_SOURCE;
+}
+
+//Appends a message to the virtual queue of its source
+static void rsu_fq_add(struct RSUnicastQueueElement* e, uint16_t source)
+{
+	struct rsu_fq_flow* f = rsu_fq_flow(source);
+	if(f->length == 0) {
+		f->source = source;
+		f->guests = 0;
+		f->deficit = 0;
+		f->head = e;
+	} else {
+		f->tail->next = e;
+		if(f->source != source) f->guests++;
+	}
+	f->tail = e;
+	f->length++;
+	rsu_fq_waiting++;
+}
+
+//Removes the next message by deficit round-robin, 0 if all virtual queues are empty
+static struct RSUnicastQueueElement* rsu_fq_dequeue()
+{
+	if(rsu_fq_waiting == 0) return 0;
+	while(1) {
+		struct rsu_fq_flow* f = &rsu_fq_flows[rsu_fq_current];
+		if(f->length > 0 && f->head->size <= f->deficit) {
+			struct RSUnicastQueueElement* e = f->head;
+			f->head = e->next;
+			e->next = 0;
+			f->deficit -= e->size;
+			f->length--;
+			if(RSU_FQ_ORIGIN(e) != f->source) f->guests--;
+			if(f->length == 0) f->deficit = 0; //an idle source does not save its share
+			rsu_fq_waiting--;
+			return e;
+		}
+		//the next virtual queue gets its quantum
+		rsu_fq_current = (rsu_fq_current+1)%RSU_FQ_FLOWS;
+		if(rsu_fq_flows[rsu_fq_current].length > 0) rsu_fq_flows[rsu_fq_current].deficit += RSU_FQ_QUANTUM;
+	}
+}
+
+/**
+ * Moves messages from the virtual queues to rsu_queue until it holds RSU_FQ_SERVICE messages. Their seqnos are assigned
+ * now.
+ */
+void rsu_fq_refill()
+{
+	struct RSUnicastQueueElement** tail = &rsu_queue;
+	uint8_t n = 0;
+	while(*tail != 0) {
+		tail = &((*tail)->next);
+		n++;
+	}
+	for(; n<RSU_FQ_SERVICE; n++) {
+		struct RSUnicastQueueElement* e = rsu_fq_dequeue();
+		if(e == 0) return;
+		((uint8_t*)(e->msg))[0] = rsu_seqno;
+		if(rsu_seqno == 0xff) rsu_seqno = 0;
+		else rsu_seqno++;
+		*tail = e;
+		tail = &(e->next);
+	}
+}
+
+#define RSU_FQ_REFILL() rsu_fq_refill()
+#else
+#define RSU_FQ_REFILL()
+#endif
+
+#endif
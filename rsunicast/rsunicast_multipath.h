@@ -0,0 +1,64 @@
+/**
+ * MODULE OF rsunicast.h (included by it after its variables)
+ *
+ * Redundant multipath delivery of critical messages (`#define RSUNICAST_MULTIPATH`). A normal message only has one way
+ * to the root, if the parent dies during the retries the message is lost.
+ *
+ * rsunicast_send_redundant sends up to RSU_MAX_CANDIDATES copies of a message, each one pinned to another first hop (the
+ * candidates of rsunicast_setCandidatesCallback, the parent first). Behind the first hop the copies are forwarded as
+ * usual. Each copy has the flag RSU_TYPE_REDUNDANT in the type byte (kept on all hops) and starts with the same
+ * end-to-end id (1 byte, counted per origin). The root remembers the last RSU_E2E_HISTORY (origin, id) pairs and passes
+ * only the first copy to the callback, without the id. Other messages are not changed and cost the same as before.
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef RSUNICAST_MULTIPATH_H
+#define RSUNICAST_MULTIPATH_H
+
+#include "contiki.h"
+
+#ifdef RSUNICAST_MULTIPATH
+
+//Number of end-to-end ids the root remembers to detect copies
+#ifndef RSU_E2E_HISTORY
+#define RSU_E2E_HISTORY 16
+#endif
+
+#define RSU_E2E_ID_SIZE 1
+
+//**VARIABLES**
+uint8_t rsu_e2e_seqno = 0; //end-to-end id of the next redundant message of this node
+#ifdef ROOT
+struct rsu_e2e_entry {
+	uint16_t origin; //0: unused
+	uint8_t id;
+};
+struct rsu_e2e_entry rsu_e2e_history[RSU_E2E_HISTORY]; //ring of the recently received redundant messages
+uint8_t rsu_e2e_next = 0;
+#endif
+//--VARIABLES--
+
+#ifdef ROOT
+/**
+ * Returns 1 iff a copy of the redundant message with the end-to-end id has already been received from the origin.
+ * Otherwise the message is remembered.
+ */
+uint8_t rsu_e2e_check(uint16_t origin, uint8_t id)
+{
+	uint8_t i;
+	for(i=0; i<RSU_E2E_HISTORY; i++) {
+		if(rsu_e2e_history[i].origin == origin && rsu_e2e_history[i].id == id) return 1;
+	}
+	rsu_e2e_history[rsu_e2e_next].origin = origin;
+	rsu_e2e_history[rsu_e2e_next].id = id;
+	rsu_e2e_next = (rsu_e2e_next+1)%RSU_E2E_HISTORY;
+	return 0;
+}
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * MODULE OF rsunicast.h (included by it after its variables)
+ *
+ * Opportunistic forwarding (`#define RSUNICAST_OPPORTUNISTIC`). Without it a message is only sent to the parent and
+ * retried up to MAX_TRIES times, even if other neighbors that are closer to the root have received it.
+ *
+ * The sender asks the MLST for a prioritized list of up to RSU_MAX_CANDIDATES neighbors that are closer to the root
+ * (rsunicast_setCandidatesCallback, the parent first) and broadcasts the message with this list on RSU_OPP_PORT.
+ * The candidate at position i that receives the message waits i*RSU_OPP_SLOT ticks, then it takes the message over:
+ * it broadcasts a claim (the id of the sender and the seqno) and enqueues the message for forwarding. The claim is the
+ * ACK for the sender and suppresses the candidates with a lower priority, which drop the message when they overhear it.
+ * If a candidate has missed the claim of a better one, both forward the message (the root then receives it twice).
+ * Without candidates (e.g. no callback or a parent that is not known to the neighborhood) the message is sent by unicast
+ * as before. With RSUNICAST_BEACON_ACK a child that hears the beacons of its parent sends a window instead if the parent
+ * is the only candidate.
+ *
+ * The data frame: RSU_OPP_DATA (1 byte), the number of candidates (1 byte), their ids (2 bytes each, little endian),
+ * then the message with its header (see rsunicast.h). The claim: RSU_OPP_CLAIM (1 byte), the id of the sender (2 bytes,
+ * little endian) and the seqno.
+ * The delays assume a MAC without long broadcast strobes (e.g. nullrdc). All nodes have to use the same setting.
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef RSUNICAST_OPPORTUNISTIC_H
+#define RSUNICAST_OPPORTUNISTIC_H
+
+#include "contiki.h"
+
+#ifdef RSUNICAST_OPPORTUNISTIC
+
+//The port of the broadcasts with the message and the candidates, and of the claims
+#define RSU_OPP_PORT 183
+//Delay per position in the list of candidates before a message is taken over
+#ifndef RSU_OPP_SLOT
+#define RSU_OPP_SLOT (CLOCK_SECOND/32)
+#endif
+//Number of received messages that can wait for their slot at the same time
+#ifndef RSU_OPP_PENDING
+#define RSU_OPP_PENDING 2
+#endif
+//Number of recently overheard claims (messages that are not taken over if they are received again)
+#ifndef RSU_OPP_SUPPRESSED
+#define RSU_OPP_SUPPRESSED 4
+#endif
+
+#define RSU_OPP_DATA 0
+#define RSU_OPP_CLAIM 1
+#define RSU_OPP_CLAIM_SIZE 4
+
+//A received message that waits for the slot of this node
+struct rsu_opp_pending {
+	uint16_t sender; //0: unused
+	uint8_t seqno;
+	uint8_t type;
+	uint16_t origin;
+	void* msg; //without the header
+	uint16_t size;
+	struct ctimer timer;
+};
+
+struct rsu_opp_claim {
+	uint16_t sender;
+	uint8_t seqno;
+};
+
+//**VARIABLES**
+struct broadcast_conn rsu_opp_channel; //channel of the messages with candidates and of the claims
+struct rsu_opp_pending rsu_opp_pending[RSU_OPP_PENDING];
+struct rsu_opp_claim rsu_opp_suppressed[RSU_OPP_SUPPRESSED]; //ring of overheard claims
+uint8_t rsu_opp_suppressed_next = 0;
+//--VARIABLES--
+
+//Returns the waiting message with the sender and seqno, 0 if there is none
+static struct rsu_opp_pending* rsu_opp_find(uint16_t sender, uint8_t seqno)
+{
+	uint8_t i;
+	for(i=0; i<RSU_OPP_PENDING; i++) {
+		if(rsu_opp_pending[i].sender == sender && rsu_opp_pending[i].seqno == seqno) return &rsu_opp_pending[i];
+	}
+	return 0;
+}
+
+//Frees a waiting message
+static void rsu_opp_release(struct rsu_opp_pending* p)
+{
+	ctimer_stop(&p->timer);
+	free(p->msg);
+	p->msg = 0;
+	p->sender = 0;
+}
+
+//Returns 1 iff the claim of another candidate for this message has been overheard recently
+static uint8_t rsu_opp_is_suppressed(uint16_t sender, uint8_t seqno)
+{
+	uint8_t i;
+	for(i=0; i<RSU_OPP_SUPPRESSED; i++) {
+		if(rsu_opp_suppressed[i].sender == sender && rsu_opp_suppressed[i].seqno == seqno) return 1;
+	}
+	return 0;
+}
+
+//Remembers the overheard claim of another candidate and drops the message if it is waiting
+static void rsu_opp_suppress(uint16_t sender, uint8_t seqno)
+{
+	struct rsu_opp_pending* p = rsu_opp_find(sender, seqno);
+	if(p != 0) rsu_opp_release(p);
+	if(rsu_opp_is_suppressed(sender, seqno)) return;
+	rsu_opp_suppressed[rsu_opp_suppressed_next].sender = sender;
+	rsu_opp_suppressed[rsu_opp_suppressed_next].seqno = seqno;
+	rsu_opp_suppressed_next = (rsu_opp_suppressed_next+1)%RSU_OPP_SUPPRESSED;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,175 @@
+/**
+ * MODULE OF mlst_network.h (ROOT ONLY)
+ *
+ * Streams the messages that arrive at the root over the serial port to a host (see ../tools/sink_daemon.py) instead of
+ * printing them. The messages are framed with SLIP (END=0xC0, ESC=0xDB) and carry a length and a CRC, such that the host
+ * can separate them from other output and detect corruption.
+ *
+ * The callback of rsunicast only copies the encoded frame into a ring buffer, the serial port is written by a separate
+ * process in small chunks. Thus the radio handling of the root is never blocked by the (slow) serial port. If the buffer
+ * is full, the message is dropped and counted. The number of dropped messages is sent in a status frame.
+ *
+ * Frame (before SLIP encoding, little endian):
+ *   type (1 byte, 1: message, 2: status) | length of payload (2) | origin (2) | last hop (2) | time at root (4, clock_time()
+ *   ticks) | payload | CRC-16 of all bytes before (2, lib/crc16.h, i.e. CRC-16/KERMIT)
+ * The payload of a status frame is the number of dropped messages (2) and CLOCK_SECOND (2).
+ *
+ * User Functions:
+ * ---------------------------
+ * void sink_serial_init(); //Starts the drain process and sends a status frame
+ * uint8_t sink_serial_write(uint16_t origin, uint16_t sender, const void* msg, uint16_t size); //Queues a message. 1 iff it has been queued.
+ * void sink_serial_on_message(void* msg, uint16_t size); //Can be directly used as callback of rsunicast_setNewMessageCallback_root
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef SINK_SERIAL_H
+#define SINK_SERIAL_H
+
+#include "contiki.h"
+#include "lib/crc16.h"
+#include <stdio.h>
+
+//Size of the ring buffer for encoded frames in bytes
+#ifndef SINK_SERIAL_BUFFER_SIZE
+#define SINK_SERIAL_BUFFER_SIZE 512
+#endif
+//Maximal number of bytes written to the serial port before the drain process yields to other processes
+#ifndef SINK_SERIAL_BYTES_PER_POLL
+#define SINK_SERIAL_BYTES_PER_POLL 32
+#endif
+
+#define SINK_SERIAL_TYPE_MESSAGE 1
+#define SINK_SERIAL_TYPE_STATUS 2
+#define SINK_SERIAL_HEADER_SIZE 11
+
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+//**VARIABLES**
+uint8_t sink_serial_buffer[SINK_SERIAL_BUFFER_SIZE];
+uint16_t sink_serial_first = 0; //index of the first byte that has not been written yet
+uint16_t sink_serial_count = 0; //number of bytes in the buffer
+uint16_t sink_serial_dropped = 0; //number of messages dropped since the last status frame
+//--VARIABLES--
+
+PROCESS(sink_serial_process, "Sink Serial");
+
+//Appends a byte to the ring buffer (space has to be checked before)
+static void sink_serial_put(uint8_t b)
+{
+	sink_serial_buffer[(sink_serial_first+sink_serial_count)%SINK_SERIAL_BUFFER_SIZE] = b;
+	sink_serial_count++;
+}
+
+//Appends a SLIP encoded byte to the ring buffer and adds it to the CRC
+static void sink_serial_put_encoded(uint8_t b, unsigned short* crc)
+{
+	if(crc != 0) *crc = crc16_add(b, *crc);
+	if(b == SLIP_END) {
+		sink_serial_put(SLIP_ESC);
+		sink_serial_put(SLIP_ESC_END);
+	} else if(b == SLIP_ESC) {
+		sink_serial_put(SLIP_ESC);
+		sink_serial_put(SLIP_ESC_ESC);
+	} else {
+		sink_serial_put(b);
+	}
+}
+
+//Encodes a frame into the ring buffer. Returns 0 if there is not enough space.
+static uint8_t sink_serial_frame(uint8_t type, uint16_t origin, uint16_t sender, const uint8_t* payload, uint16_t size)
+{
+	uint8_t header[SINK_SERIAL_HEADER_SIZE];
+	unsigned short crc = 0;
+	uint16_t i;
+	uint32_t now = clock_time();
+	//worst case: every byte escaped and two END bytes
+	if(2*(SINK_SERIAL_HEADER_SIZE+size+2)+2 > SINK_SERIAL_BUFFER_SIZE-sink_serial_count) return 0;
+	header[0] = type;
+	header[1] = size & 0xff;
+	header[2] = size >> 8;
+	header[3] = origin & 0xff;
+	header[4] = origin >> 8;
+	header[5] = sender & 0xff;
+	header[6] = sender >> 8;
+	header[7] = now & 0xff;
+	header[8] = (now >> 8) & 0xff;
+	header[9] = (now >> 16) & 0xff;
+	header[10] = (now >> 24) & 0xff;
+	sink_serial_put(SLIP_END); //flushes garbage on the line
+	for(i=0; i<SINK_SERIAL_HEADER_SIZE; i++) sink_serial_put_encoded(header[i], &crc);
+	for(i=0; i<size; i++) sink_serial_put_encoded(payload[i], &crc);
+	unsigned short frame_crc = crc;
+	sink_serial_put_encoded(frame_crc & 0xff, 0);
+	sink_serial_put_encoded(frame_crc >> 8, 0);
+	sink_serial_put(SLIP_END);
+	process_poll(&sink_serial_process);
+	return 1;
+}
+
+//Queues a status frame with the number of dropped messages
+static void sink_serial_status()
+{
+	uint8_t payload[4] = {sink_serial_dropped & 0xff, sink_serial_dropped >> 8, CLOCK_SECOND & 0xff, CLOCK_SECOND >> 8};
+	if(sink_serial_frame(SINK_SERIAL_TYPE_STATUS, 0, 0, payload, sizeof(payload))) sink_serial_dropped = 0;
+}
+
+/**
+ * Queues a message for the host. Returns 1 iff it has been queued, 0 if the buffer is full and it has been dropped.
+ * Cheap enough to be called from the receive callback.
+ */
+uint8_t sink_serial_write(uint16_t origin, uint16_t sender, const void* msg, uint16_t size)
+{
+	if(sink_serial_dropped > 0) sink_serial_status();
+	if(sink_serial_frame(SINK_SERIAL_TYPE_MESSAGE, origin, sender, (const uint8_t*) msg, size) == 0) {
+		sink_serial_dropped++;
+		return 0;
+	}
+	return 1;
+}
+
+#ifdef ROOT
+/**
+ * Callback for rsunicast_setNewMessageCallback_root that streams every message with its origin and last hop.
+ */
+void sink_serial_on_message(void* msg, uint16_t size)
+{
+	sink_serial_write(rsunicast_message_origin(), rsunicast_message_sender(), msg, size);
+}
+#endif
+
+/**
+ * Writes the buffer in small chunks to the serial port.
+ */
+PROCESS_THREAD(sink_serial_process, ev, data)
+{
+	PROCESS_BEGIN();
+	while(1) {
+		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+		uint8_t n = 0;
+		while(sink_serial_count > 0 && n < SINK_SERIAL_BYTES_PER_POLL) {
+			putchar(sink_serial_buffer[sink_serial_first]);
+			sink_serial_first = (sink_serial_first+1)%SINK_SERIAL_BUFFER_SIZE;
+			sink_serial_count--;
+			n++;
+		}
+		if(sink_serial_count > 0) process_poll(&sink_serial_process); //continue after the other processes had their turn
+	}
+	PROCESS_END();
+}
+
+/**
+ * Starts the drain process and tells the host the clock rate with a status frame.
+ */
+void sink_serial_init()
+{
+	process_start(&sink_serial_process, 0);
+	sink_serial_status();
+}
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * MODULE OF mlst_network.h (also used by ./public_variable_neighborhood and ./rsunicast)
+ *
+ * Integer-only timing. The MCUs of the nodes have no floating point unit, every float multiplication and conversion is a
+ * call into the soft-float library. Therefore all delays are computed in ticks (clock_time_t) and the jitter is drawn
+ * from a fast xorshift generator:
+ *
+ *   * The parameters in seconds (e.g. MLST_PERIOD_LENGTH_IN_SECONDS, TIMEOUT_IN_SEC) are only converted into ticks by
+ *     constant expressions, which the compiler evaluates (TIMING_TICKS).
+ *   * timing_random(max) draws a number of ticks in [0, max] with a multiplication and a shift instead of a division.
+ *   * timing_between(a, b) draws in [a, b], e.g. a period of 80-100% is timing_between(period - period/5, period).
+ *
+ * The generator is seeded with the node address on the first use (or explicitly with timing_seed), so the neighbors do
+ * not share the sequence.
+ *
+ * User Functions:
+ * ---------------------------
+ * void timing_seed(uint16_t seed); //Seeds the generator (optional, the node address is used otherwise)
+ * uint16_t timing_rand(); //Returns a random 16 bit number
+ * clock_time_t timing_random(clock_time_t max); //Returns a random number of ticks in [0, max]
+ * clock_time_t timing_between(clock_time_t a, clock_time_t b); //Returns a random number of ticks in [a, b]
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "contiki.h"
+#include "net/rime/rime.h"
+
+//Converts a constant time in seconds (also fractions, e.g. 0.2) into ticks at compile time
+#define TIMING_TICKS(seconds) ((clock_time_t)((seconds)*CLOCK_SECOND))
+
+//**VARIABLES**
+uint32_t timing_state = 0; //state of the xorshift generator, 0 if it is not seeded yet
+//--VARIABLES--
+
+/**
+ * Seeds the generator. Without a call it is seeded with the node address on the first use.
+ */
+void timing_seed(uint16_t seed)
+{
+	timing_state = 0x9E3779B9UL ^ seed; //xorshift must not start with 0
+}
+
+/**
+ * Returns a random 16 bit number (xorshift32, only shifts and xors).
+ */
+uint16_t timing_rand()
+{
+	if(timing_state == 0) timing_seed((linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1]);
+	timing_state ^= timing_state << 13;
+	timing_state ^= timing_state >> 17;
+	timing_state ^= timing_state << 5;
+	return (uint16_t)(timing_state >> 16);
+}
+
+/**
+ * Returns a random number of ticks in [0, max].
+ */
+clock_time_t timing_random(clock_time_t max)
+{
+	if((unsigned long) max < 0xffffUL) {
+		return (clock_time_t)(((uint32_t) timing_rand() * ((uint32_t) max + 1)) >> 16);
+	}
+	if((uint32_t) max == 0xffffffffUL) return (((uint32_t) timing_rand() << 16) | timing_rand());
+	return (clock_time_t)((((uint32_t) timing_rand() << 16) | timing_rand()) % ((uint32_t) max + 1));
+}
+
+/**
+ * Returns a random number of ticks in [a, b] (a <= b).
+ */
+clock_time_t timing_between(clock_time_t a, clock_time_t b)
+{
+	return a + timing_random(b - a);
+}
+
+#endif
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""
+RAM/ROM footprint report of the MLST library per build configuration.
+
+Compiles ../host/mlst_footprint.c for every variant (base, EA1, EA2, EA3, ROOT) and reads the symbol sizes of the object
+file with nm. Nothing is executed, so a cross compiler can be used (and should be, for numbers that are valid on INGA):
+
+    * static RAM and ROM per module (PVN, rsunicast, MLST, trace, ...) from the sizes of the global symbols
+    * the sizes of the heap allocated structs (Nbr, public variable, RSUnicastQueueElement, rsu_history_element)
+    * the worst-case heap for the given capacities: every neighbor entry with its public variable, a full message queue
+      and a full history (MAX_HISTORY_SIZE), each allocation with the overhead of malloc
+
+The PVN and the queue have no limit in the code, so their capacities are parameters of the report. The root never
+forwards, its queue is counted as empty. Symbols of the Contiki core (or of the host shim) are not counted.
+
+Examples:
+    ./mlst_footprint.py                                   # avr-gcc if found, otherwise the host gcc
+    ./mlst_footprint.py --cc avr-gcc --nm avr-nm --cflags "-mmcu=atmega1284p -Os" --neighbors 16 --queue 4
+    ./mlst_footprint.py --define MLST_TRACE --define RSUNICAST_COUNTERS --csv > footprint.csv
+
+@author Dominik Krupke, d.krupke@tu-bs.de
+@licence MIT
+"""
+
+import argparse
+import csv
+import os
+import shlex
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+PROBE = os.path.join(ROOT_DIR, "host", "mlst_footprint.c")
+VARIANTS = {"base": [], "EA1": ["-DEA1"], "EA2": ["-DEA2"], "EA3": ["-DEA3"], "ROOT": ["-DROOT"]}
+
+# (module, symbol prefixes); the first match wins
+MODULES = [
+    ("pvn", ("pvn_", "on_new_neighbor_information", "list_of_all_public_variable_neighborhoods")),
+    ("rsunicast", ("rsu_", "rsunicast_")),
+    ("stats", ("mlst_stats",)),
+    ("mlst", ("mlst_", "own_mlst_", "eamlst_", "divide_period_time_by", "onPvn", "pvnCmp", "process_thread_mlst_")),
+    ("trace", ("trace_", "record_", "process_thread_trace_")),
+    ("radio_energy", ("radio_energy_",)),
+    ("radio_power", ("radio_power_",)),
+    ("cpu_power", ("cpu_power_",)),
+    ("convergecast", ("convergecast_",)),
+    ("beacon_slots", ("beacon_slots_",)),
+    ("rate_limit", ("rate_limit_",)),
+    ("load_aware", ("load_aware_",)),
+    ("timing", ("timing_",)),
+    ("topology", ("topology_",)),
+]
+RAM_TYPES = set("bBdDrRgGsSvV")  # on AVR constant data is copied to RAM as well
+ROM_TYPES = set("tTdDrR")
+
+
+def module_of(symbol):
+    for module, prefixes in MODULES:
+        if symbol.startswith(prefixes):
+            return module
+    return None
+
+
+def analyze(args, flags):
+    with tempfile.TemporaryDirectory() as tmp:
+        obj = os.path.join(tmp, "footprint.o")
+        cmd = [args.cc, "-std=gnu99", "-c", "-I", os.path.join(ROOT_DIR, "host"), "-o", obj, PROBE]
+        cmd += shlex.split(args.cflags) + flags + ["-D" + d for d in args.define]
+        subprocess.run(cmd, check=True)
+        out = subprocess.run([args.nm, "-S", obj], check=True, capture_output=True, text=True).stdout
+    sizes, ram, rom = {}, {}, {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) != 4:
+            continue  # undefined symbols have no size
+        size, type_, name = int(parts[1], 16), parts[2], parts[3]
+        if name.startswith("footprint_"):
+            sizes[name[len("footprint_"):]] = size - 1
+            continue
+        module = module_of(name)
+        if module is None:
+            continue
+        if type_ in RAM_TYPES:
+            ram[module] = ram.get(module, 0) + size
+        if type_ in ROM_TYPES:
+            rom[module] = rom.get(module, 0) + size
+    return sizes, ram, rom
+
+
+def heap(args, sizes, is_root):
+    o = args.malloc_overhead
+    pvn = args.neighbors * (sizes["sizeof_Nbr"] + sizes["sizeof_mlst_public_variable"] + 2 * o)
+    queue = 0 if is_root else args.queue * (sizes["sizeof_RSUnicastQueueElement"] + sizes["const_RSU_HEADER_SIZE"]
+                                            + args.message_size + 2 * o)
+    history = sizes["const_MAX_HISTORY_SIZE"] * (sizes["sizeof_rsu_history_element"] + o)
+    return {"heap_pvn": pvn, "heap_queue": queue, "heap_history": history}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    default_cc = "avr-gcc" if shutil.which("avr-gcc") else "gcc"
+    parser.add_argument("--cc", default=default_cc, help="compiler (default: %(default)s)")
+    parser.add_argument("--nm", help="nm of the toolchain (default: derived from --cc)")
+    parser.add_argument("--cflags", default="-Os", help="extra compiler flags, e.g. \"-mmcu=atmega1284p -Os\"")
+    parser.add_argument("--define", action="append", default=[], help="feature flag for all variants (repeatable)")
+    parser.add_argument("--variants", default=",".join(VARIANTS), help="comma separated subset of " + ",".join(VARIANTS))
+    parser.add_argument("--neighbors", type=int, default=10, help="neighbor entries in the PVN")
+    parser.add_argument("--queue", type=int, default=8, help="messages in the rsunicast queue")
+    parser.add_argument("--message-size", type=int, default=16, help="user data bytes per message")
+    parser.add_argument("--malloc-overhead", type=int, default=2, help="bytes per allocation (2 for avr-libc)")
+    parser.add_argument("--csv", action="store_true")
+    args = parser.parse_args()
+    if args.nm is None:
+        args.nm = args.cc[:-3] + "nm" if args.cc.endswith("gcc") and args.cc != "gcc" else "nm"
+
+    rows = []
+    for variant in args.variants.split(","):
+        sizes, ram, rom = analyze(args, VARIANTS[variant])
+        row = {"variant": variant, "pointer": sizes["sizeof_pointer"]}
+        for key in ("Nbr", "mlst_public_variable", "RSUnicastQueueElement", "rsu_history_element"):
+            row["sizeof_" + key] = sizes["sizeof_" + key]
+        for module, _ in MODULES:
+            row["ram_" + module] = ram.get(module, 0)
+            row["rom_" + module] = rom.get(module, 0)
+        row.update(heap(args, sizes, variant == "ROOT"))
+        row["ram_static"] = sum(ram.values())
+        row["rom"] = sum(rom.values())
+        row["heap_worst"] = row["heap_pvn"] + row["heap_queue"] + row["heap_history"]
+        row["ram_worst"] = row["ram_static"] + row["heap_worst"]
+        rows.append(row)
+
+    if args.csv:
+        w = csv.DictWriter(sys.stdout, fieldnames=list(rows[0]))
+        w.writeheader()
+        w.writerows(rows)
+        return
+    print("compiler: %s %s %s" % (args.cc, args.cflags, " ".join("-D" + d for d in args.define)))
+    print("capacities: %d neighbors, %d queued messages of %d bytes, malloc overhead %d bytes"
+          % (args.neighbors, args.queue, args.message_size, args.malloc_overhead))
+    if rows[0]["pointer"] != 2:
+        print("note: pointers are %d bytes, the sizes are not the ones of INGA (use --cc avr-gcc)" % rows[0]["pointer"])
+    for row in rows:
+        print("\n[%s]" % row["variant"])
+        print("  structs: Nbr=%d, public variable=%d, queue element=%d, history element=%d" % (
+            row["sizeof_Nbr"], row["sizeof_mlst_public_variable"], row["sizeof_RSUnicastQueueElement"],
+            row["sizeof_rsu_history_element"]))
+        print("  %-14s %8s %8s" % ("module", "RAM", "ROM"))
+        for module, _ in MODULES:
+            if row["ram_" + module] or row["rom_" + module]:
+                print("  %-14s %8d %8d" % (module, row["ram_" + module], row["rom_" + module]))
+        print("  %-14s %8d %8d" % ("total static", row["ram_static"], row["rom"]))
+        print("  worst-case heap: PVN=%d, queue=%d, history=%d, total=%d" % (
+            row["heap_pvn"], row["heap_queue"], row["heap_history"], row["heap_worst"]))
+        print("  worst-case RAM: %d" % row["ram_worst"])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+"""
+Parameter sweep for the MLST tuning parameters (see ../mlst_config.h).
+
+Runs a grid or random search over the parameters in Cooja, every configuration with several random seeds, in parallel on
+all cores, and reports the Pareto front of
+
+    * leaves              (mean number of leaves at the end of the run, maximize)
+    * convergence time    (last parent change of any node in seconds, minimize)
+    * delivery ratio      ('Received Message' at the root / 'Sent Message' at the nodes, maximize, deferred
+                          readings are not counted)
+    * radio-on time       (mean radio-on percentage from Cooja's PowerTracker, minimize)
+
+The simulation template is a normal Cooja .csc (e.g. built from ../mlst_network_example_node.c and
+../mlst_network_example_root.c) whose mote types are compiled with `DEFINES=MLST_RUNTIME_CONFIG`, so the same firmware is
+used for all runs and the parameters are sent to the motes via the serial port ('NAME=VALUE' lines) at the start of each
+run. The random seed and the test script of the template are replaced, a PowerTracker is added if missing.
+
+If the motes are also built with RADIO_ENERGY_ACCOUNTING (../radio_energy/radio_energy.h), the last ENERGY report of each
+mote is integrated over the network and the per component radio usage is written to the CSV as well. Likewise the
+MLST_STATS reports (../mlst_stats.h) are aggregated into parent changes, stay-active periods, cannot-decide rounds and the
+worst time to first parent.
+
+Example:
+    ./mlst_sweep.py --contiki ~/contiki --csc mlst.csc --duration 600 --seeds 5 \\
+        --grid MAX_AGE_OF_PARENT=3,5,8 --grid TIMEOUT_IN_SEC=0.1,0.2 --grid MAX_TRIES=3,5
+
+    ./mlst_sweep.py --contiki ~/contiki --csc mlst.csc --random 40 \\
+        --range MLST_PERIOD_LENGTH_IN_SECONDS=0.5:3 --range IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS=1:6
+
+@author Dominik Krupke, d.krupke@tu-bs.de
+@licence MIT
+"""
+
+import argparse
+import concurrent.futures
+import csv
+import itertools
+import math
+import os
+import random
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+PARAMETERS = {  # name -> is integer
+    "MAX_AGE_OF_MLST_NBR_IN_SECONDS": True,
+    "MLST_PERIOD_LENGTH_IN_SECONDS": False,
+    "IF_CHANGE_STAY_ACTIVE_FOR_N_PERIODS": True,
+    "MAX_AGE_OF_PARENT": True,
+    "TIMEOUT_IN_SEC": False,
+    "MAX_TRIES": True,
+}
+
+# (name, maximize)
+OBJECTIVES = [("leaves", True), ("convergence_s", False), ("delivery_ratio", True), ("radio_on_pct", False)]
+
+SCRIPT = """
+TIMEOUT(%(timeout_ms)d, stats = plugin.radioStatistics().split("\\n"); for(var i=0; i<stats.length; i++){ log.log("SWEEP-POWER " + stats[i] + "\\n"); } log.testOK(); );
+plugin = sim.getCooja().getStartedPlugin("PowerTracker");
+if(plugin == null) { log.log("SWEEP-ERROR no PowerTracker\\n"); log.testFailed(); }
+motes = sim.getMotes();
+for(var i=0; i<motes.length; i++) {
+%(writes)s
+}
+while(true) {
+  log.log(time + " " + id + " " + msg + "\\n");
+  YIELD();
+}
+"""
+
+SCRIPT_PLUGIN = """  <plugin>
+    org.contikios.cooja.plugins.ScriptRunner
+    <plugin_config>
+      <script>%s</script>
+      <active>true</active>
+    </plugin_config>
+  </plugin>
+"""
+
+POWER_PLUGIN = """  <plugin>
+    PowerTracker
+  </plugin>
+"""
+
+
+def xml_escape(s):
+    return s.replace("&", "&amp;").replace("<", "&lt;").replace(">", "&gt;")
+
+
+def make_csc(template, config, seed, duration):
+    writes = "\n".join('  write(motes[i], "%s=%s");' % (k, v) for k, v in sorted(config.items()))
+    script = SCRIPT % {"timeout_ms": duration * 1000, "writes": writes}
+    csc = re.sub(r"<randomseed>.*?</randomseed>", "<randomseed>%d</randomseed>" % seed, template, flags=re.S)
+    csc = re.sub(r"\s*<plugin>\s*org\.contikios\.cooja\.plugins\.ScriptRunner.*?</plugin>", "", csc, flags=re.S)
+    plugins = SCRIPT_PLUGIN % xml_escape(script)
+    if "PowerTracker" not in csc:
+        plugins += POWER_PLUGIN
+    return csc.replace("</simconf>", plugins + "</simconf>")
+
+
+MLST_LINE = re.compile(r"MLST\[Parent:(\d+), #Children:(\d+)\]")
+POWER_LINE = re.compile(r"SWEEP-POWER \S+ ON [\d.]+ us ([\d.]+) %")
+ENERGY_COMPONENT = re.compile(r"(\w+):\(on=(\d+)ms, tx=(\d+)/(\d+)B, rx=(\d+)/(\d+)B\)")
+ENERGY_TOTAL = re.compile(r"RADIO_ON=(\d+)ms, IDLE=(\d+)ms")
+STATS_FIELD = re.compile(r"(\w+)=(\d+)")
+
+
+def parse_energy(msg):
+    """Parses an ENERGY[...] report of radio_energy_print_state into a flat dict."""
+    values = {}
+    for name, on, txf, txb, rxf, rxb in ENERGY_COMPONENT.findall(msg):
+        name = name.lower()
+        values.update({name + "_on_ms": int(on), name + "_tx_bytes": int(txb), name + "_rx_bytes": int(rxb),
+                       name + "_tx_frames": int(txf), name + "_rx_frames": int(rxf)})
+    m = ENERGY_TOTAL.search(msg)
+    if m:
+        values.update({"radio_on_ms": int(m.group(1)), "idle_ms": int(m.group(2))})
+    return values
+
+
+def evaluate_log(path, duration):
+    """Extracts the metrics of a single run from the Cooja test log."""
+    parents = {}  # mote -> (parent, children) of the last report
+    energy = {}  # mote -> values of the last ENERGY report
+    stats = {}  # mote -> values of the last MLST_STATS report
+    last_change = 0.0
+    sent = received = 0
+    radio_on = []
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = POWER_LINE.search(line)
+            if m:
+                radio_on.append(float(m.group(1)))
+                continue
+            parts = line.split(" ", 2)
+            if len(parts) < 3 or not parts[0].isdigit():
+                continue
+            t, mote, msg = int(parts[0]) / 1e6, parts[1], parts[2]
+            if "Sent Message" in msg:
+                sent += 1
+            elif "Received Message" in msg:
+                received += 1
+            if msg.startswith("ENERGY["):
+                energy[mote] = parse_energy(msg)
+                continue
+            if msg.startswith("MLST_STATS["):
+                stats[mote] = {k: int(v) for k, v in STATS_FIELD.findall(msg)}
+                continue
+            m = MLST_LINE.search(msg)
+            if m:
+                parent, children = int(m.group(1)), int(m.group(2))
+                if mote in parents and parents[mote][0] != parent:
+                    last_change = t
+                parents[mote] = (parent, children)
+    defined = all(p != 0 for p, _ in parents.values()) and len(parents) > 0
+    result = {
+        "leaves": sum(1 for p, c in parents.values() if p != 0 and c == 0),
+        "convergence_s": last_change if defined else float("inf"),
+        "delivery_ratio": received / sent if sent > 0 else 0.0,
+        "radio_on_pct": sum(radio_on) / len(radio_on) if radio_on else float("nan"),
+    }
+    for values in energy.values():  # network wide sums
+        for key, v in values.items():
+            result["energy_" + key] = result.get("energy_" + key, 0) + v
+    if stats:
+        for key in ("parent_changes", "stay_active", "cannot_decide", "awake", "asleep"):
+            result["stats_" + key] = sum(v.get(key, 0) for v in stats.values())
+        result["stats_max_first_parent_s"] = max(v.get("first_parent", 0) for v in stats.values())
+        result["stats_min_longest_streak"] = min(v.get("longest_streak", 0) for v in stats.values())
+    return result
+
+
+def run(args, template, config, seed):
+    workdir = tempfile.mkdtemp(prefix="mlst_sweep_")
+    try:
+        csc = os.path.join(workdir, "run.csc")
+        with open(csc, "w") as f:
+            f.write(make_csc(template, config, seed, args.duration))
+        cmd = ["java", "-mx512m", "-jar", os.path.join(args.contiki, "tools/cooja/dist/cooja.jar"),
+               "-nogui=" + csc, "-contiki=" + args.contiki]
+        subprocess.run(cmd, cwd=workdir, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, timeout=args.wall_timeout)
+        log = os.path.join(workdir, "COOJA.testlog")
+        if not os.path.exists(log):
+            return None
+        return evaluate_log(log, args.duration)
+    except subprocess.TimeoutExpired:
+        return None
+    finally:
+        if not args.keep:
+            shutil.rmtree(workdir, ignore_errors=True)
+
+
+def parse_value(name, v):
+    return int(v) if PARAMETERS[name] else float(v)
+
+
+def configurations(args):
+    if args.random:
+        ranges = {}
+        for r in args.range:
+            name, span = r.split("=")
+            lo, hi = span.split(":")
+            ranges[name] = (parse_value(name, lo), parse_value(name, hi))
+        rnd = random.Random(args.search_seed)
+        for _ in range(args.random):
+            yield {n: (rnd.randint(lo, hi) if PARAMETERS[n] else round(rnd.uniform(lo, hi), 3)) for n, (lo, hi) in ranges.items()}
+    else:
+        axes = []
+        for g in args.grid:
+            name, values = g.split("=")
+            axes.append([(name, parse_value(name, v)) for v in values.split(",")])
+        for combination in itertools.product(*axes):
+            yield dict(combination)
+
+
+def dominates(a, b):
+    better = False
+    for key, maximize in OBJECTIVES:
+        x, y = (a[key], b[key]) if maximize else (-a[key], -b[key])
+        if x < y:
+            return False
+        if x > y:
+            better = True
+    return better
+
+
+def pareto_front(rows):
+    return [r for r in rows if not any(dominates(o, r) for o in rows if o is not r)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--contiki", default=os.environ.get("CONTIKI"), help="Contiki root (default: $CONTIKI)")
+    parser.add_argument("--csc", required=True, help="Cooja simulation template")
+    parser.add_argument("--duration", type=int, default=600, help="simulated seconds per run")
+    parser.add_argument("--seeds", type=int, default=3, help="random seeds per configuration")
+    parser.add_argument("--grid", action="append", default=[], help="NAME=v1,v2,... (grid search)")
+    parser.add_argument("--random", type=int, default=0, help="number of random configurations (random search)")
+    parser.add_argument("--range", action="append", default=[], help="NAME=min:max (random search)")
+    parser.add_argument("--search-seed", type=int, default=0, help="seed for drawing the random configurations")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="parallel Cooja instances (default: all cores)")
+    parser.add_argument("--wall-timeout", type=int, default=3600, help="wall clock seconds before a run is aborted")
+    parser.add_argument("--out", default="mlst_sweep.csv", help="CSV with the results of all configurations")
+    parser.add_argument("--keep", action="store_true", help="keep the working directories of the runs")
+    args = parser.parse_args()
+
+    if not args.contiki:
+        parser.error("--contiki or $CONTIKI required")
+    for name in [g.split("=")[0] for g in args.grid + args.range]:
+        if name not in PARAMETERS:
+            parser.error("unknown parameter %s (known: %s)" % (name, ", ".join(PARAMETERS)))
+    with open(args.csc) as f:
+        template = f.read()
+
+    configs = list(configurations(args))
+    jobs = [(c, i, s) for i, c in enumerate(configs) for s in range(1, args.seeds + 1)]
+    results = {i: [] for i in range(len(configs))}
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        futures = {pool.submit(run, args, template, c, s): i for c, i, s in jobs}
+        for n, future in enumerate(concurrent.futures.as_completed(futures), 1):
+            r = future.result()
+            if r is not None:
+                results[futures[future]].append(r)
+            print("\r%d/%d runs" % (n, len(jobs)), end="", file=sys.stderr)
+    print(file=sys.stderr)
+
+    rows = []
+    for i, c in enumerate(configs):
+        if not results[i]:
+            print("configuration %s failed in all runs" % c, file=sys.stderr)
+            continue
+        row = dict(c)
+        for key in sorted({k for r in results[i] for k in r}):
+            row[key] = sum(r.get(key, 0) for r in results[i]) / len(results[i])
+        row["runs"] = len(results[i])
+        rows.append(row)
+    if not rows:
+        sys.exit("no successful runs")
+
+    energy_fields = sorted({k for r in rows for k in r if k.startswith("energy_")})
+    stats_fields = sorted({k for r in rows for k in r if k.startswith("stats_")})
+    fields = (sorted({k for c in configs for k in c}) + [k for k, _ in OBJECTIVES] + energy_fields + stats_fields
+              + ["runs"])
+    with open(args.out, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=fields, restval=0)
+        writer.writeheader()
+        writer.writerows(rows)
+
+    front = sorted(pareto_front(rows), key=lambda r: -r["leaves"])
+    print("Pareto front (%d of %d configurations):" % (len(front), len(rows)))
+    for r in front:
+        params = " ".join("%s=%s" % (k, r[k]) for k in sorted(configs[0]))
+        conv = "inf" if math.isinf(r["convergence_s"]) else "%.1fs" % r["convergence_s"]
+        print("  %s -> leaves=%.1f convergence=%s delivery=%.3f radio_on=%.2f%%"
+              % (params, r["leaves"], conv, r["delivery_ratio"], r["radio_on_pct"]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+"""
+Host side of the root's serial sink (../sink/sink_serial.h).
+
+Reads the SLIP framed messages of the root from a serial device (or a file/stdin), checks length and CRC and appends
+them in batches to an append-only record file. Reading and writing run in separate threads, so a slow disk never
+stalls the serial port (whose buffer is small) and thousands of messages per second are sustained.
+
+Record file format (little endian):
+    header:  b"MLSTSINK" + version (1 byte, 1)
+    record:  host time (float64, unix seconds) | root time (uint32, ticks) | origin (uint16) | last hop (uint16) |
+             length (uint16) | payload
+The file is only appended to, so it can be read while the daemon is running and survives crashes up to the last
+batch. Use --dump to convert it to CSV (root time converted to seconds with --clock-second).
+
+Examples:
+    ./sink_daemon.py --device /dev/ttyUSB0 --baud 115200 --out sink.mlst
+    ./sink_daemon.py --dump sink.mlst > messages.csv
+
+@author Dominik Krupke, d.krupke@tu-bs.de
+@licence MIT
+"""
+
+import argparse
+import csv
+import os
+import queue
+import struct
+import sys
+import threading
+import time
+
+MAGIC = b"MLSTSINK\x01"
+RECORD = struct.Struct("<dIHHH")
+FRAME_HEADER = struct.Struct("<BHHHI")  # type, length, origin, last hop, root time
+TYPE_MESSAGE = 1
+TYPE_STATUS = 2
+
+SLIP_END, SLIP_ESC, SLIP_ESC_END, SLIP_ESC_ESC = 0xC0, 0xDB, 0xDC, 0xDD
+
+
+def _crc_table():
+    table = []
+    for b in range(256):
+        crc = b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+        table.append(crc)
+    return table
+
+
+CRC_TABLE = _crc_table()
+
+
+def crc16(data, crc=0):
+    """CRC-16/KERMIT as crc16_add() of Contiki's lib/crc16.c."""
+    for b in data:
+        crc = (crc >> 8) ^ CRC_TABLE[(crc ^ b) & 0xff]
+    return crc
+
+
+class SlipDecoder:
+    """Splits a byte stream into SLIP frames. Bytes outside of frames (e.g. printf output) are dropped."""
+
+    def __init__(self):
+        self.frame = bytearray()
+
+    def feed(self, data):
+        frames = []
+        for chunk in data.split(bytes([SLIP_END])):
+            self.frame += chunk
+            frames.append(bytes(self.frame))
+            self.frame = bytearray()
+        # the last piece has no END yet
+        self.frame = bytearray(frames.pop())
+        return [self.unescape(f) for f in frames if f]
+
+    @staticmethod
+    def unescape(frame):
+        if SLIP_ESC not in frame:
+            return frame
+        return frame.replace(bytes([SLIP_ESC, SLIP_ESC_END]), bytes([SLIP_END])).replace(
+            bytes([SLIP_ESC, SLIP_ESC_ESC]), bytes([SLIP_ESC]))
+
+
+def parse_frame(frame):
+    """Returns (type, origin, last hop, root ticks, payload) or None if the frame is corrupted."""
+    if len(frame) < FRAME_HEADER.size + 2:
+        return None
+    type_, length, origin, sender, ticks = FRAME_HEADER.unpack_from(frame)
+    if len(frame) != FRAME_HEADER.size + length + 2:
+        return None
+    if crc16(frame[:-2]) != frame[-2] | frame[-1] << 8:
+        return None
+    return type_, origin, sender, ticks, frame[FRAME_HEADER.size:-2]
+
+
+def reader(source, out, stats):
+    decoder = SlipDecoder()
+    while True:
+        data = source()
+        if data is None:
+            break
+        if not data:
+            continue
+        now = time.time()
+        for frame in decoder.feed(data):
+            parsed = parse_frame(frame)
+            if parsed is None:
+                stats["corrupted"] += 1
+                continue
+            type_, origin, sender, ticks, payload = parsed
+            if type_ == TYPE_MESSAGE:
+                out.put((now, ticks, origin, sender, payload))
+            elif type_ == TYPE_STATUS and len(payload) >= 4:
+                dropped, clock_second = struct.unpack_from("<HH", payload)
+                stats["dropped_at_root"] += dropped
+                stats["clock_second"] = clock_second
+    out.put(None)
+
+
+def writer(path, q, stats, batch_size, batch_interval):
+    new = not os.path.exists(path) or os.path.getsize(path) == 0
+    with open(path, "ab", buffering=0) as f:
+        if new:
+            f.write(MAGIC)
+        batch = bytearray()
+        count = 0
+        deadline = time.monotonic() + batch_interval
+        done = False
+        while not done:
+            try:
+                item = q.get(timeout=max(0.0, deadline - time.monotonic()))
+                if item is None:
+                    done = True
+                else:
+                    now, ticks, origin, sender, payload = item
+                    batch += RECORD.pack(now, ticks, origin, sender, len(payload)) + payload
+                    count += 1
+            except queue.Empty:
+                pass
+            if batch and (done or count >= batch_size or time.monotonic() >= deadline):
+                f.write(batch)  # a single write per batch
+                stats["written"] += count
+                batch = bytearray()
+                count = 0
+            if time.monotonic() >= deadline:
+                deadline = time.monotonic() + batch_interval
+
+
+def read_records(path):
+    with open(path, "rb") as f:
+        if f.read(len(MAGIC)) != MAGIC:
+            raise ValueError("%s is not a sink record file" % path)
+        while True:
+            head = f.read(RECORD.size)
+            if len(head) < RECORD.size:
+                return
+            now, ticks, origin, sender, length = RECORD.unpack(head)
+            payload = f.read(length)
+            if len(payload) < length:
+                return  # incomplete last record of a running daemon
+            yield now, ticks, origin, sender, payload
+
+
+def dump(path, clock_second):
+    w = csv.writer(sys.stdout)
+    w.writerow(["host_time", "root_time", "origin", "last_hop", "length", "payload"])
+    for now, ticks, origin, sender, payload in read_records(path):
+        w.writerow(["%.6f" % now, "%.3f" % (ticks / clock_second), origin, sender, len(payload), payload.hex()])
+
+
+def open_source(args):
+    if args.device:
+        import serial  # pyserial, only needed for live capturing
+        port = serial.Serial(args.device, args.baud, timeout=0.05)
+        return lambda: port.read(max(1, port.in_waiting))
+    f = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+    return lambda: f.read1(65536) or None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", default="-", help="raw serial capture or - for stdin (if no --device)")
+    parser.add_argument("--device", help="serial device of the root (needs pyserial)")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--out", default="sink.mlst", help="record file to append to")
+    parser.add_argument("--batch-size", type=int, default=1000, help="records per write")
+    parser.add_argument("--batch-interval", type=float, default=0.5, help="seconds after which a batch is written anyway")
+    parser.add_argument("--dump", metavar="FILE", help="convert a record file to CSV and exit")
+    parser.add_argument("--clock-second", type=int, default=128, help="ticks per second for --dump")
+    args = parser.parse_args()
+
+    if args.dump:
+        dump(args.dump, args.clock_second)
+        return
+
+    stats = {"written": 0, "corrupted": 0, "dropped_at_root": 0, "clock_second": None}
+    q = queue.Queue()
+    t = threading.Thread(target=writer, args=(args.out, q, stats, args.batch_size, args.batch_interval), daemon=True)
+    t.start()
+    start = time.monotonic()
+    try:
+        reader(open_source(args), q, stats)
+    except KeyboardInterrupt:
+        q.put(None)
+    t.join()
+    elapsed = max(time.monotonic() - start, 1e-9)
+    print("%d messages written (%.0f/s), %d invalid frames (corrupted or other output), %d dropped at the root"
+          % (stats["written"], stats["written"] / elapsed, stats["corrupted"], stats["dropped_at_root"]), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+Decoder for the binary event trace of ../trace/trace.h.
+
+Reads the raw serial stream of a node (from a file, stdin or a serial device) and writes one row per record as CSV or as
+JSON lines. Bytes that do not belong to a valid record (e.g. printf output on the same port) are skipped, with
+--text they are written to stderr.
+
+Examples:
+    ./trace_decode.py trace.bin > trace.csv
+    ./trace_decode.py --format json --device /dev/ttyUSB0 --baud 38400
+    cat trace.bin | ./trace_decode.py --text -
+
+@author Dominik Krupke, d.krupke@tu-bs.de
+@licence MIT
+"""
+
+import argparse
+import csv
+import json
+import sys
+
+START_BYTE = 0xA5
+RECORD_SIZE = 12
+
+# type -> (name, meaning of id, meaning of arg, meaning of value); keep in sync with ../trace/trace.h
+EVENTS = {
+    0x01: ("BOOT", "node", "", "clock_second"),
+    0x02: ("LOST", "", "", "records"),
+    0x03: ("MALFORMED", "sender", "port", "length"),
+    0x10: ("NBR_NEW", "neighbor", "", ""),
+    0x11: ("NBR_CHANGE", "neighbor", "", ""),
+    0x12: ("NBR_DELETE", "neighbor", "", ""),
+    0x13: ("SOLICIT", "sender", "", "answer_delay"),
+    0x20: ("PARENT_CHANGE", "parent", "children", "old_parent"),
+    0x21: ("CANNOT_DECIDE", "", "candidates", ""),
+    0x22: ("SLEEP", "", "", ""),
+    0x23: ("WAKE", "", "", ""),
+    0x24: ("FIRST_PARENT", "parent", "", "seconds"),
+    0x25: ("STREAK_END", "parent", "", "periods"),
+    0x26: ("DIGEST_SLEEP", "parent", "digest", ""),
+    0x30: ("TX", "receiver", "try", "size"),
+    0x31: ("RX", "sender", "seqno", "size"),
+    0x32: ("ACK", "sender", "", ""),
+    0x33: ("TIMEOUT", "parent", "tries", ""),
+    0x34: ("DROP", "parent", "tries", ""),
+    0x35: ("DUPLICATE", "sender", "seqno", ""),
+    0x36: ("CLAIM", "sender", "seqno", "position"),
+    0x37: ("SUPPRESS", "candidate", "seqno", ""),
+}
+
+FIELDS = ["node", "time", "ticks", "event", "id", "arg", "value"]
+
+
+def decode(chunks, text_out=None):
+    """Generator of (type, arg, ticks, id, value) from an iterable of byte chunks."""
+    buf = bytearray()
+    for chunk in chunks:
+        buf += chunk
+        i = 0
+        while len(buf) - i >= RECORD_SIZE:
+            if buf[i] != START_BYTE:
+                if text_out is not None:
+                    text_out.write(chr(buf[i]))
+                i += 1
+                continue
+            body = buf[i + 1:i + 11]
+            checksum = 0
+            for b in body:
+                checksum ^= b
+            if checksum != buf[i + 11] or body[0] not in EVENTS:
+                if text_out is not None:
+                    text_out.write(chr(buf[i]))
+                i += 1
+                continue
+            yield (body[0], body[1], int.from_bytes(body[2:6], "little"), int.from_bytes(body[6:8], "little"),
+                   int.from_bytes(body[8:10], "little"))
+            i += RECORD_SIZE
+        del buf[:i]
+
+
+def read_chunks(args):
+    if args.device:
+        import serial  # pyserial, only needed for live decoding
+        port = serial.Serial(args.device, args.baud, timeout=1)
+        while True:
+            yield port.read(256)
+    f = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+    while True:
+        chunk = f.read(4096)
+        if not chunk:
+            return
+        yield chunk
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", default="-", help="raw trace file or - for stdin")
+    parser.add_argument("--device", help="read live from this serial device (needs pyserial)")
+    parser.add_argument("--baud", type=int, default=38400)
+    parser.add_argument("--format", choices=["csv", "json"], default="csv")
+    parser.add_argument("--clock-second", type=int, default=128, help="ticks per second until a BOOT record is seen")
+    parser.add_argument("--text", action="store_true", help="write the non-trace bytes (printf output) to stderr")
+    args = parser.parse_args()
+
+    out = sys.stdout
+    writer = None
+    if args.format == "csv":
+        writer = csv.DictWriter(out, fieldnames=FIELDS)
+        writer.writeheader()
+    node, clock_second = None, args.clock_second
+    for type_, arg, ticks, id_, value in decode(read_chunks(args), sys.stderr if args.text else None):
+        name = EVENTS[type_][0]
+        if name == "BOOT":
+            node, clock_second = id_, value or clock_second
+        row = {"node": node, "time": round(ticks / clock_second, 4), "ticks": ticks, "event": name,
+               "id": id_, "arg": arg, "value": value}
+        if writer:
+            writer.writerow(row)
+        else:
+            _, id_name, arg_name, value_name = EVENTS[type_]
+            obj = {"node": node, "time": row["time"], "event": name}
+            for key, field in ((id_name, "id"), (arg_name, "arg"), (value_name, "value")):
+                if key:
+                    obj[key] = row[field]
+            out.write(json.dumps(obj) + "\n")
+        out.flush()
+
+
+if __name__ == "__main__":
+    main()
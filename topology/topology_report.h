@@ -0,0 +1,224 @@
+/**
+ * MODULE OF mlst_network.h
+ *
+ * Low-rate topology report service. Every node sends a compact report about its position in the tree to the root, which
+ * keeps an incrementally updated model of the whole tree and can export it as an adjacency snapshot (e.g. for dashboards).
+ *
+ * The reports are sent with rsunicast as messages of type RSU_TYPE_TOPOLOGY, thus they do not reach the user callback of
+ * the root. A report is only sent if its content has changed (parent, children count, energy class) or as keepalive after
+ * TOPOLOGY_REPORT_PERIOD_IN_SECONDS. Small changes of the queue depth and the RSSI do not trigger a report.
+ *
+ * The service is only compiled in if `TOPOLOGY_REPORT` is defined. mlst_init() then initializes it and the MLST process
+ * updates it once per period.
+ *
+ * Report (6 bytes, little endian):
+ *   parent (2) | children count (1) | messages in queue (1) | RSSI of the last beacon of the parent (1, signed) | energy class (1)
+ * The energy class is the energy_state of the EA variants (1: High, 2: Middle, 3: Low) and 0 for the base MLST.
+ *
+ * User Functions:
+ * ---------------------------
+ * void topology_report_init(); //Called by mlst_init()
+ * void topology_report_update(uint16_t parent, uint8_t children, uint8_t energy_class, struct Nbr* parent_nbr); //Called by the MLST process
+ * ROOT ONLY: struct topology_entry* topology_get_entries(); //First entry of the tree model (iterate with topology_get_next_entry)
+ * ROOT ONLY: struct topology_entry* topology_get_next_entry(struct topology_entry* e); //0 if there is none
+ * ROOT ONLY: void topology_print_snapshot(); //Prints the tree model as one JSON line prefixed with "TOPO "
+ * ROOT ONLY: void topology_on_message(uint8_t type, void* msg, uint16_t size); //Used as typed callback of rsunicast
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef TOPOLOGY_REPORT_H
+#define TOPOLOGY_REPORT_H
+
+#include "contiki.h"
+#include "net/rime/rime.h"
+#include "../timing/timing.h"
+#include <stdio.h>
+#include "../rsunicast/rsunicast.h"
+#include "../public_variable_neighborhood/public_variable_neighborhood.h"
+
+//A node sends a report at least every TOPOLOGY_REPORT_PERIOD_IN_SECONDS (jittered by up to 25%)
+#ifndef TOPOLOGY_REPORT_PERIOD_IN_SECONDS
+#define TOPOLOGY_REPORT_PERIOD_IN_SECONDS 300
+#endif
+//Entries at the root that have not been refreshed for this time are removed (a few lost keepalives are tolerated)
+#ifndef TOPOLOGY_MAX_AGE_IN_SECONDS
+#define TOPOLOGY_MAX_AGE_IN_SECONDS (3*TOPOLOGY_REPORT_PERIOD_IN_SECONDS)
+#endif
+//Maximal number of nodes in the tree model of the root
+#ifndef TOPOLOGY_MAX_NODES
+#define TOPOLOGY_MAX_NODES 32
+#endif
+
+#define TOPOLOGY_REPORT_SIZE 6
+
+struct topology_report {
+	uint16_t parent;
+	uint8_t children;
+	uint8_t queue;
+	int8_t rssi;
+	uint8_t energy_class;
+};
+
+#ifndef ROOT
+//**VARIABLES**
+struct topology_report topology_last_report; //The last report that has been sent
+unsigned long topology_next_keepalive = 0; //clock_seconds() at which the next report is sent in any case
+uint8_t topology_has_reported = 0; //1 iff a report has been sent
+//--VARIABLES--
+
+//Converts the report into the wire format
+static void topology_encode(const struct topology_report* r, uint8_t* buf)
+{
+	buf[0] = r->parent & 0xff;
+	buf[1] = r->parent >> 8;
+	buf[2] = r->children;
+	buf[3] = r->queue;
+	buf[4] = (uint8_t) r->rssi;
+	buf[5] = r->energy_class;
+}
+
+/**
+ * Called once per MLST period. Sends a report if the content changed or the keepalive is due.
+ * Nothing is sent as long as the parent is undefined, the root learns about it by the timeout of the entry.
+ */
+void topology_report_update(uint16_t parent, uint8_t children, uint8_t energy_class, struct Nbr* parent_nbr)
+{
+	struct topology_report r;
+	uint8_t buf[TOPOLOGY_REPORT_SIZE];
+	if(parent == 0) return;
+	r.parent = parent;
+	r.children = children;
+	r.queue = rsu_messages_in_queue > 0xff ? 0xff : rsu_messages_in_queue;
+	r.rssi = parent_nbr != 0 ? parent_nbr->rssi : 0;
+	r.energy_class = energy_class;
+	if(topology_has_reported != 0 && clock_seconds() < topology_next_keepalive
+			&& r.parent == topology_last_report.parent && r.children == topology_last_report.children
+			&& r.energy_class == topology_last_report.energy_class) {
+		return; //nothing relevant has changed
+	}
+	topology_encode(&r, buf);
+	rsunicast_send_typed(RSU_TYPE_TOPOLOGY, buf, TOPOLOGY_REPORT_SIZE);
+	topology_last_report = r;
+	topology_has_reported = 1;
+	topology_next_keepalive = clock_seconds() + TOPOLOGY_REPORT_PERIOD_IN_SECONDS
+			- timing_random(TOPOLOGY_REPORT_PERIOD_IN_SECONDS/4);
+}
+
+/**
+ * Nothing to do for normal nodes. The first report is sent as soon as the parent is defined.
+ */
+void topology_report_init()
+{
+}
+#else
+
+struct topology_entry {
+	uint16_t id;
+	struct topology_report report;
+	unsigned long timestamp; //clock_seconds() of the last report
+};
+
+//**VARIABLES**
+struct topology_entry topology_entries[TOPOLOGY_MAX_NODES];
+uint8_t topology_entry_count = 0; //entries in use are at the beginning of the array
+uint16_t topology_dropped_reports = 0; //reports of new nodes that did not fit into the table
+//--VARIABLES--
+
+//Removes entries that have not been refreshed for TOPOLOGY_MAX_AGE_IN_SECONDS
+static void topology_remove_old_entries()
+{
+	uint8_t i = 0;
+	while(i < topology_entry_count) {
+		if(clock_seconds() - topology_entries[i].timestamp > TOPOLOGY_MAX_AGE_IN_SECONDS) {
+			topology_entries[i] = topology_entries[--topology_entry_count]; //order is irrelevant
+		} else {
+			i++;
+		}
+	}
+}
+
+/**
+ * Callback for rsunicast_setTypedMessageCallback_root. Updates the entry of the origin of the report.
+ * If you need the typed callback for something else, call this function from there.
+ */
+void topology_on_message(uint8_t type, void* msg, uint16_t size)
+{
+	uint8_t* buf = (uint8_t*) msg;
+	uint16_t origin = rsunicast_message_origin();
+	uint8_t i;
+	if(type != RSU_TYPE_TOPOLOGY || size < TOPOLOGY_REPORT_SIZE) return;
+	for(i=0; i<topology_entry_count; i++) {
+		if(topology_entries[i].id == origin) break;
+	}
+	if(i == topology_entry_count) { //new node
+		topology_remove_old_entries();
+		if(topology_entry_count == TOPOLOGY_MAX_NODES) {
+			topology_dropped_reports++;
+			return;
+		}
+		i = topology_entry_count++;
+		topology_entries[i].id = origin;
+	}
+	topology_entries[i].report.parent = buf[0] | ((uint16_t)buf[1])<<8;
+	topology_entries[i].report.children = buf[2];
+	topology_entries[i].report.queue = buf[3];
+	topology_entries[i].report.rssi = (int8_t) buf[4];
+	topology_entries[i].report.energy_class = buf[5];
+	topology_entries[i].timestamp = clock_seconds();
+}
+
+/**
+ * Returns the first entry of the tree model or 0 if it is empty. Outdated entries are removed before.
+ */
+struct topology_entry* topology_get_entries()
+{
+	topology_remove_old_entries();
+	return topology_entry_count > 0 ? &topology_entries[0] : 0;
+}
+
+/**
+ * Returns the entry after e or 0 if e is the last one.
+ */
+struct topology_entry* topology_get_next_entry(struct topology_entry* e)
+{
+	return e+1 < topology_entries+topology_entry_count ? e+1 : 0;
+}
+
+/**
+ * Prints the tree model as a single line of JSON, e.g.
+ * TOPO {"root":1,"time":1234,"dropped":0,"nodes":[{"id":2,"parent":1,"children":1,"queue":0,"rssi":-60,"energy":0,"age":12},...]}
+ * The edges of the tree are given by the parents.
+ */
+void topology_print_snapshot()
+{
+	struct topology_entry* e = topology_get_entries();
+	printf("TOPO {\"root\":%u,\"time\":%lu,\"dropped\":%u,\"nodes\":[", (linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1],
+			clock_seconds(), topology_dropped_reports);
+	for(; e!=0; e=topology_get_next_entry(e)) {
+		printf("%s{\"id\":%u,\"parent\":%u,\"children\":%u,\"queue\":%u,\"rssi\":%d,\"energy\":%u,\"age\":%lu}",
+				e == &topology_entries[0] ? "" : ",", e->id, e->report.parent, e->report.children, e->report.queue,
+				e->report.rssi, e->report.energy_class, clock_seconds() - e->timestamp);
+	}
+	printf("]}\n");
+}
+
+/**
+ * Registers topology_on_message as typed callback of rsunicast.
+ */
+void topology_report_init()
+{
+	rsunicast_setTypedMessageCallback_root(topology_on_message);
+}
+
+/**
+ * The root does not report itself.
+ */
+void topology_report_update(uint16_t parent, uint8_t children, uint8_t energy_class, struct Nbr* parent_nbr)
+{
+}
+#endif
+
+#endif
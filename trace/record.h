@@ -0,0 +1,86 @@
+/**
+ * MODULE OF mlst_network.h
+ *
+ * Recording of all received frames (PVN beacons, rsunicast messages and ACKs) with their timestamps, such that a run can
+ * be replayed deterministically in the native harness ../host/mlst_replay.c (e.g. to compare two versions of
+ * mlst_recalculate on exactly the same input).
+ *
+ * The recording is only compiled in if `MLST_RECORD` is defined. The frames are written directly in the receive callbacks
+ * to the serial port, thus it slows down the receiving a little and should only be used for benchmark runs.
+ *
+ * Wire format of a frame (little endian):
+ *   0xA6 | port (2 bytes) | time (4 bytes, clock_time() ticks) | sender (2 bytes) | length (1 byte) | payload | XOR of all bytes after 0xA6
+ * The first frame after RECORD_INIT has port 0, the own id as sender and CLOCK_SECOND (2 bytes) as payload.
+ * The frames share the serial port with printf output and the trace (./trace.h), the replay resynchronizes.
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "contiki.h"
+#include "net/rime/rime.h"
+#include <stdio.h>
+
+#define RECORD_START_BYTE 0xA6
+
+#ifdef MLST_RECORD
+
+//Writes one byte and adds it to the checksum
+static void record_put(uint8_t b, uint8_t* checksum)
+{
+	putchar(b);
+	*checksum ^= b;
+}
+
+/**
+ * Writes a frame with the given payload. Use the macro RECORD_FRAME for received frames.
+ */
+void record_write(uint16_t port, uint16_t from, const uint8_t* payload, uint8_t length)
+{
+	uint8_t checksum = 0, i;
+	clock_time_t now = clock_time();
+	putchar(RECORD_START_BYTE);
+	record_put(port & 0xff, &checksum);
+	record_put(port >> 8, &checksum);
+	record_put(now & 0xff, &checksum);
+	record_put((now >> 8) & 0xff, &checksum);
+	record_put(((uint32_t)now >> 16) & 0xff, &checksum);
+	record_put(((uint32_t)now >> 24) & 0xff, &checksum);
+	record_put(from & 0xff, &checksum);
+	record_put(from >> 8, &checksum);
+	record_put(length, &checksum);
+	for(i=0; i<length; i++) {
+		record_put(payload[i], &checksum);
+	}
+	putchar(checksum);
+}
+
+/**
+ * Records the frame in the packetbuf that has been received on the port from the sender.
+ */
+void record_received_frame(uint16_t port, const linkaddr_t* from)
+{
+	uint16_t length = packetbuf_datalen();
+	if(length > 0xff) length = 0xff;
+	record_write(port, ((uint16_t)from->u8[0])<<8 | from->u8[1], (const uint8_t*) packetbuf_dataptr(), length);
+}
+
+/**
+ * Writes the header frame (own id and clock rate). Called by mlst_init().
+ */
+void record_init()
+{
+	uint8_t clock_second[2] = {CLOCK_SECOND & 0xff, CLOCK_SECOND >> 8};
+	record_write(0, (linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1], clock_second, 2);
+}
+
+#define RECORD_FRAME(port, from) record_received_frame(port, from)
+#else
+#define RECORD_FRAME(port, from)
+#endif
+
+#endif
@@ -0,0 +1,196 @@
+/**
+ * MODULE OF mlst_network.h
+ *
+ * Compact binary event trace. Instead of formatting text on the node (see the '#ifdef DEBUG' printfs), events are saved
+ * as fixed-size records in a ring buffer and drained over the serial port by a low priority process.
+ * Use ../tools/trace_decode.py on the host to convert the stream into CSV or JSON.
+ *
+ * The trace is only compiled in if `MLST_TRACE` is defined. Otherwise TRACE_EVENT is empty and costs nothing.
+ *
+ * Wire format of a record (12 bytes, little endian):
+ *   0xA5 | type | arg | time (4 bytes, clock_time() ticks) | id (2 bytes) | value (2 bytes) | XOR of the 10 bytes before
+ * The stream shares the serial port with printf output, the decoder resynchronizes with the start byte and the checksum.
+ * If the ring buffer overflows, the oldest records are overwritten and a TRACE_LOST record with the number of lost records
+ * is emitted.
+ *
+ * User Functions:
+ * ---------------------------
+ * void trace_init(); //Starts the drain process and emits TRACE_BOOT. Called by mlst_init().
+ * TRACE_EVENT(type, arg, id, value); //Records an event
+ * uint8_t trace_read(struct trace_record* r); //Takes the oldest record out of the buffer (if you want to drain yourself). 1 iff a record has been read.
+ * void trace_set_serial_drain(uint8_t on); //Switches the automatic draining to the serial port on (default) or off
+ *
+ * @author Dominik Krupke, d.krupke@tu-bs.de
+ * @year 2015
+ * @licence MIT
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "contiki.h"
+#include "net/rime/rime.h"
+#include <stdio.h>
+
+//**EVENT TYPES** (keep in sync with ../tools/trace_decode.py)
+#define TRACE_BOOT 0x01 //id=own id, value=CLOCK_SECOND
+#define TRACE_LOST 0x02 //value=number of overwritten records
+#define TRACE_MALFORMED 0x03 //id=sender, arg=port (low byte), value=length (frame rejected by the length check)
+#define TRACE_NBR_NEW 0x10 //id=neighbor
+#define TRACE_NBR_CHANGE 0x11 //id=neighbor
+#define TRACE_NBR_DELETE 0x12 //id=neighbor
+#define TRACE_SOLICIT 0x13 //id=sender (0: sent by this node), value=delay of the answer in ticks
+#define TRACE_PARENT_CHANGE 0x20 //id=new parent (0: undefined), value=old parent, arg=children count
+#define TRACE_CANNOT_DECIDE 0x21 //arg=number of potential parents
+#define TRACE_SLEEP 0x22 //channels of the leaf closed for a period
+#define TRACE_WAKE 0x23 //channels opened again
+#define TRACE_FIRST_PARENT 0x24 //id=parent, value=seconds since mlst_init (../mlst_stats.h)
+#define TRACE_STREAK_END 0x25 //id=parent of the streak, value=periods with this parent (../mlst_stats.h)
+#define TRACE_DIGEST_SLEEP 0x26 //id=parent, arg=digest (leaf slept again without recalculation)
+#define TRACE_TX 0x30 //id=receiver, arg=try, value=size
+#define TRACE_RX 0x31 //id=sender, arg=seqno, value=size
+#define TRACE_ACK 0x32 //id=sender of the ACK
+#define TRACE_TIMEOUT 0x33 //id=parent, arg=tries
+#define TRACE_DROP 0x34 //id=parent, arg=tries (message discarded after MAX_TRIES)
+#define TRACE_DUPLICATE 0x35 //id=sender, arg=seqno
+#define TRACE_CLAIM 0x36 //id=sender, arg=seqno, value=position in the candidates (opportunistic forwarding)
+#define TRACE_SUPPRESS 0x37 //id=claiming candidate, arg=seqno (overheard claim of another candidate)
+//--EVENT TYPES--
+
+#ifdef MLST_TRACE
+
+//Number of records in the ring buffer
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE 32
+#endif
+#define TRACE_START_BYTE 0xA5
+
+struct trace_record {
+	uint32_t time;
+	uint16_t id;
+	uint16_t value;
+	uint8_t type;
+	uint8_t arg;
+};
+
+//**VARIABLES**
+struct trace_record trace_buffer[TRACE_BUFFER_SIZE];
+uint8_t trace_first = 0; //index of the oldest record
+uint8_t trace_count = 0; //number of records in the buffer
+uint16_t trace_lost = 0; //overwritten records since the last drain
+uint8_t trace_serial_drain = 1; //1 iff the drain process writes the records to the serial port
+//--VARIABLES--
+
+PROCESS(trace_process, "Trace Drain");
+
+/**
+ * Records an event. Use the macro TRACE_EVENT instead, so the call vanishes without MLST_TRACE.
+ */
+void trace_event(uint8_t type, uint8_t arg, uint16_t id, uint16_t value)
+{
+	struct trace_record* r;
+	if(trace_count == TRACE_BUFFER_SIZE) { //full, overwrite oldest
+		trace_first = (trace_first+1)%TRACE_BUFFER_SIZE;
+		trace_count--;
+		trace_lost++;
+	}
+	r = &trace_buffer[(trace_first+trace_count)%TRACE_BUFFER_SIZE];
+	r->time = clock_time();
+	r->type = type;
+	r->arg = arg;
+	r->id = id;
+	r->value = value;
+	trace_count++;
+	if(trace_serial_drain) process_poll(&trace_process);
+}
+
+/**
+ * Takes the oldest record out of the buffer. Returns 1 iff there has been a record.
+ */
+uint8_t trace_read(struct trace_record* r)
+{
+	if(trace_count == 0) return 0;
+	*r = trace_buffer[trace_first];
+	trace_first = (trace_first+1)%TRACE_BUFFER_SIZE;
+	trace_count--;
+	return 1;
+}
+
+/**
+ * Switches the automatic draining to the serial port on or off.
+ */
+void trace_set_serial_drain(uint8_t on)
+{
+	trace_serial_drain = on;
+	if(on) process_poll(&trace_process);
+}
+
+//Writes a single record in the wire format to the serial port
+static void trace_write(struct trace_record* r)
+{
+	uint8_t bytes[10];
+	uint8_t i, checksum = 0;
+	bytes[0] = r->type;
+	bytes[1] = r->arg;
+	bytes[2] = r->time & 0xff;
+	bytes[3] = (r->time>>8) & 0xff;
+	bytes[4] = (r->time>>16) & 0xff;
+	bytes[5] = (r->time>>24) & 0xff;
+	bytes[6] = r->id & 0xff;
+	bytes[7] = r->id>>8;
+	bytes[8] = r->value & 0xff;
+	bytes[9] = r->value>>8;
+	putchar(TRACE_START_BYTE);
+	for(i=0; i<sizeof(bytes); i++) {
+		putchar(bytes[i]);
+		checksum ^= bytes[i];
+	}
+	putchar(checksum);
+}
+
+/**
+ * Drains the buffer to the serial port whenever it is polled. Runs outside of the radio callbacks.
+ */
+PROCESS_THREAD(trace_process, ev, data)
+{
+	static struct trace_record r;
+	PROCESS_BEGIN();
+	while(1) {
+		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+		if(trace_serial_drain == 0) continue;
+		if(trace_lost > 0) {
+			r.time = clock_time();
+			r.type = TRACE_LOST;
+			r.arg = 0;
+			r.id = 0;
+			r.value = trace_lost;
+			trace_lost = 0;
+			trace_write(&r);
+		}
+		while(trace_read(&r)) {
+			trace_write(&r);
+		}
+	}
+	PROCESS_END();
+}
+
+/**
+ * Starts the drain process and records the boot event with the own id and the clock rate.
+ * Can be called multiple times.
+ */
+void trace_init()
+{
+	static uint8_t is_initialized = 0;
+	if(is_initialized == 0) {
+		process_start(&trace_process, 0);
+		trace_event(TRACE_BOOT, 0, (linkaddr_node_addr.u8[0]<<8) | linkaddr_node_addr.u8[1], CLOCK_SECOND);
+		is_initialized = 1;
+	}
+}
+
+#define TRACE_EVENT(type, arg, id, value) trace_event(type, arg, id, value)
+#else
+#define TRACE_EVENT(type, arg, id, value)
+#endif
+
+#endif